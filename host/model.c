@@ -0,0 +1,344 @@
+/***
+ * Copyright 2023, zhuguangtao@iie.ac.cn, SKLOIS
+ *
+ * User-space models of the allocators measured by MR-MC.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <mcmc/workload.h>
+#include "model.h"
+
+#define MODEL_NIL UINT32_MAX
+/* Nodes of the buddy tree of a frame pool, the root is node 0 */
+#define MODEL_POOL_NODES (2 * MCMC_MODEL_POOL_FRAMES - 1)
+
+const char *const mcmc_model_names[MCMC_MODELS] = {
+    "cascading", "cascading-bulk", "capbuddy"
+};
+
+static void model_push(mcmc_model_t *model, uint32_t block, int order)
+{
+    uint32_t head = model->free_head[order];
+
+    model->free_order[block] = order;
+    model->prev[block] = MODEL_NIL;
+    model->next[block] = head;
+    if (head != MODEL_NIL) {
+        model->prev[head] = block;
+    }
+    model->free_head[order] = block;
+}
+
+static void model_remove(mcmc_model_t *model, uint32_t block)
+{
+    int order = model->free_order[block];
+
+    if (model->prev[block] == MODEL_NIL) {
+        model->free_head[order] = model->next[block];
+    } else {
+        model->next[model->prev[block]] = model->next[block];
+    }
+    if (model->next[block] != MODEL_NIL) {
+        model->prev[model->next[block]] = model->prev[block];
+    }
+    model->free_order[block] = -1;
+}
+
+/* Order of the next initial block, with 'left' frames of the pool to go */
+static int model_initial_order(uint32_t left)
+{
+    int order = 31 - __builtin_clz(left);
+
+    return order > MCMC_MODEL_MAX_ORDER ? MCMC_MODEL_MAX_ORDER : order;
+}
+
+static void model_account(mcmc_model_stats_t *stats, int order)
+{
+    if (stats->slots > stats->peak_slots) {
+        stats->peak_slots = stats->slots;
+    }
+    stats->live_frames += 1u << order;
+    if (stats->live_frames > stats->peak_live_frames) {
+        stats->peak_live_frames = stats->live_frames;
+    }
+}
+
+/***
+ * CapBuddy frame pools: the buddy tree of a pool keeps, for every node, the
+ * largest order that is free within its subtree, so as a node is wholly
+ * free if that is its own order. Node 'n' of depth 'd' covers the frames
+ * from ((n + 1 - 2^d) << (MCMC_MODEL_POOL_ORDER - d)) on.
+ */
+static int8_t *model_pool_tree(mcmc_model_t *model, uint32_t pool)
+{
+    return model->pool_tree + (size_t)pool * MODEL_POOL_NODES;
+}
+
+static void model_pool_reset(int8_t *tree)
+{
+    for (int depth = 0; depth <= MCMC_MODEL_POOL_ORDER; ++depth)
+    {
+        memset(tree + (1u << depth) - 1, MCMC_MODEL_POOL_ORDER - depth, 1u << depth);
+    }
+}
+
+/* Recompute the ancestors of node 'n' of order 'order', counting the merges of wholly free buddies */
+static void model_pool_update(int8_t *tree, uint32_t n, int order, uint64_t *merges)
+{
+    while (n)
+    {
+        uint32_t parent = (n - 1) / 2;
+        int8_t left = tree[2 * parent + 1];
+        int8_t right = tree[2 * parent + 2];
+
+        if (left == order && right == order) {
+            tree[parent] = order + 1;
+            if (merges) {
+                (*merges)++;
+            }
+        } else {
+            tree[parent] = left > right ? left : right;
+        }
+        n = parent;
+        order++;
+    }
+}
+
+static int64_t model_pool_alloc(mcmc_model_t *model, uint32_t frame_count)
+{
+    mcmc_model_stats_t *stats = &model->stats;
+    int order = mcmc_frame_order(frame_count);
+    uint32_t pool = MODEL_NIL;
+
+    /* Leftmost active pool with a block large enough, or else the first inactive one */
+    for (uint32_t p = 0; p < model->pools; ++p)
+    {
+        if (model->pool_live[p] && model_pool_tree(model, p)[0] >= order) {
+            pool = p;
+            break;
+        }
+        if (!model->pool_live[p] && pool == MODEL_NIL) {
+            pool = p;
+        }
+    }
+    if (pool == MODEL_NIL) {
+        return -1;
+    }
+    int8_t *tree = model_pool_tree(model, pool);
+
+    if (model->pool_live[pool] == 0) {
+        /* The pool is retyped into frames as a whole */
+        stats->invocations += (MCMC_MODEL_POOL_FRAMES + model->fan_out - 1) / model->fan_out;
+        stats->slots += MCMC_MODEL_POOL_FRAMES;
+    }
+    /* Leftmost block of the order, splitting every wholly free node on the way down */
+    uint32_t n = 0;
+    uint32_t offset = 0;
+
+    for (int node_order = MCMC_MODEL_POOL_ORDER; node_order > order; --node_order)
+    {
+        if (tree[n] == node_order) {
+            stats->splits++;
+        }
+        n = 2 * n + 1;
+        if (tree[n] < order) {
+            n++;
+            offset += 1u << (node_order - 1);
+        }
+    }
+    tree[n] = -1;
+    model_pool_update(tree, n, order, NULL);
+    model->pool_live[pool] += 1u << order;
+    model_account(stats, order);
+    return (int64_t)pool * MCMC_MODEL_POOL_FRAMES + offset;
+}
+
+static void model_pool_free(mcmc_model_t *model, uint32_t block, uint32_t frame_count)
+{
+    mcmc_model_stats_t *stats = &model->stats;
+    int order = mcmc_frame_order(frame_count);
+    uint32_t pool = block / MCMC_MODEL_POOL_FRAMES;
+    uint32_t offset = block % MCMC_MODEL_POOL_FRAMES;
+    int8_t *tree = model_pool_tree(model, pool);
+    uint32_t n = (1u << (MCMC_MODEL_POOL_ORDER - order)) - 1 + (offset >> order);
+
+    tree[n] = order;
+    model_pool_update(tree, n, order, &stats->merges);
+    stats->live_frames -= 1u << order;
+    model->pool_live[pool] -= 1u << order;
+    if (model->pool_live[pool] == 0) {
+        /* One revoke of the pool untyped gets rid of all of its frames */
+        stats->invocations++;
+        stats->slots -= MCMC_MODEL_POOL_FRAMES;
+    }
+}
+
+int mcmc_model_init(mcmc_model_t *model, int kind, uint32_t frames, uint32_t fan_out)
+{
+    uint32_t offset = 0;
+
+    memset(model, 0, sizeof(*model));
+    if (frames == 0 || fan_out == 0) {
+        return -1;
+    }
+    model->kind = kind;
+    model->fan_out = fan_out;
+    model->frames = frames;
+    if (kind == MCMC_MODEL_CAPBUDDY) {
+        model->pools = frames / MCMC_MODEL_POOL_FRAMES;
+        if (model->pools == 0) {
+            return -1;
+        }
+        model->pool_tree = malloc((size_t)model->pools * MODEL_POOL_NODES);
+        model->pool_live = calloc(model->pools, sizeof(*model->pool_live));
+        if (!model->pool_tree || !model->pool_live) {
+            mcmc_model_destroy(model);
+            return -1;
+        }
+        for (uint32_t p = 0; p < model->pools; ++p)
+        {
+            model_pool_reset(model_pool_tree(model, p));
+        }
+        return 0;
+    }
+    model->free_order = malloc(frames * sizeof(*model->free_order));
+    model->next = malloc(frames * sizeof(*model->next));
+    model->prev = malloc(frames * sizeof(*model->prev));
+    if (!model->free_order || !model->next || !model->prev) {
+        mcmc_model_destroy(model);
+        return -1;
+    }
+    for (int order = 0; order <= MCMC_MODEL_MAX_ORDER; ++order)
+    {
+        model->free_head[order] = MODEL_NIL;
+    }
+    for (uint32_t i = 0; i < frames; ++i)
+    {
+        model->free_order[i] = -1;
+    }
+    /**
+     * Largest blocks first: every block is then naturally aligned, and
+     * there is at most one initial block of every order, so no block ever
+     * merges with a buddy beyond the end of the pool.
+     */
+    model->max_order = model_initial_order(frames);
+    while (offset < frames)
+    {
+        int order = model_initial_order(frames - offset);
+
+        model_push(model, offset, order);
+        offset += 1u << order;
+    }
+    return 0;
+}
+
+void mcmc_model_destroy(mcmc_model_t *model)
+{
+    free(model->free_order);
+    free(model->next);
+    free(model->prev);
+    free(model->pool_tree);
+    free(model->pool_live);
+    model->free_order = NULL;
+    model->next = NULL;
+    model->prev = NULL;
+    model->pool_tree = NULL;
+    model->pool_live = NULL;
+}
+
+int64_t mcmc_model_alloc(mcmc_model_t *model, uint32_t frame_count)
+{
+    mcmc_model_stats_t *stats = &model->stats;
+    int order = mcmc_frame_order(frame_count);
+    int found = order;
+    uint32_t block;
+
+    if (model->kind == MCMC_MODEL_CAPBUDDY) {
+        return model_pool_alloc(model, frame_count);
+    }
+    while (found <= model->max_order && model->free_head[found] == MODEL_NIL)
+    {
+        found++;
+    }
+    if (found > model->max_order) {
+        return -1;
+    }
+    block = model->free_head[found];
+    model_remove(model, block);
+    /* Split down to the requested order, keeping the lower half */
+    while (found > order)
+    {
+        found--;
+        model_push(model, block + (1u << found), found);
+        stats->splits++;
+        stats->invocations++;
+        stats->slots += 2;
+    }
+    if (model->kind == MCMC_MODEL_CASCADING) {
+        stats->invocations += frame_count;
+        stats->slots += frame_count;
+    } else {
+        stats->invocations += (frame_count + model->fan_out - 1) / model->fan_out;
+    }
+    model_account(stats, order);
+    return block;
+}
+
+void mcmc_model_free(mcmc_model_t *model, uint32_t block, uint32_t frame_count)
+{
+    mcmc_model_stats_t *stats = &model->stats;
+    int order = mcmc_frame_order(frame_count);
+
+    if (model->kind == MCMC_MODEL_CAPBUDDY) {
+        model_pool_free(model, block, frame_count);
+        return;
+    }
+    /* One revoke of the block gets rid of everything retyped from it */
+    stats->invocations++;
+    if (model->kind == MCMC_MODEL_CASCADING) {
+        stats->slots -= frame_count;
+    }
+    stats->live_frames -= 1u << order;
+
+    while (order < model->max_order)
+    {
+        uint32_t buddy = block ^ (1u << order);
+
+        if (buddy >= model->frames || model->free_order[buddy] != order) {
+            break;
+        }
+        model_remove(model, buddy);
+        block &= ~(1u << order);
+        order++;
+        stats->merges++;
+        stats->invocations++;
+        stats->slots -= 2;
+    }
+    model_push(model, block, order);
+}
+
+bool mcmc_model_clean(const mcmc_model_t *model)
+{
+    uint32_t offset = 0;
+
+    if (model->kind == MCMC_MODEL_CAPBUDDY) {
+        for (uint32_t p = 0; p < model->pools; ++p)
+        {
+            if (model->pool_live[p] || model->pool_tree[(size_t)p * MODEL_POOL_NODES] != MCMC_MODEL_POOL_ORDER) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    while (offset < model->frames)
+    {
+        int order = model_initial_order(model->frames - offset);
+
+        if (model->free_order[offset] != order) {
+            return false;
+        }
+        offset += 1u << order;
+    }
+    return true;
+}
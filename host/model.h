@@ -0,0 +1,104 @@
+/***
+ * Copyright 2023, zhuguangtao@iie.ac.cn, SKLOIS
+ *
+ * User-space models of the allocators measured by MR-MC.
+ *
+ * The cascading allocators hand out power-of-two blocks of untyped memory
+ * from a binary buddy system over the whole pool, which is modelled frame
+ * by frame so as the very same request stream fragments the model just as
+ * it fragments the real pool. Every split of a larger block is one more
+ * Untyped_Retype into two cslots, and every merge of two buddies one more
+ * revoke. On top of its block, a memory unit costs:
+ *  - cascading:      one Untyped_Retype and one cslot per frame
+ *  - cascading-bulk: the same with MRMCBulkRetype, frames are retyped into
+ *                    a pre-allocated CNode, KernelRetypeFanOutLimit at a time
+ * CapBuddy instead grants every request one contiguous run of frames out
+ * of a frame pool: an untyped of MCMC_MODEL_POOL_FRAMES frames, retyped
+ * into frames as a whole (KernelRetypeFanOutLimit at a time) once the
+ * first request lands in it, and revoked once its last frames are freed.
+ * Within a pool, blocks are split and merged by a buddy tree at user level,
+ * which costs no invocations and no cslots, and every request goes to the
+ * leftmost active pool it fits in, or else to the first inactive one.
+ * Frames beyond the last whole pool are never used.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <mcmc/workload.h>
+
+#define MCMC_MODEL_MAX_ORDER 31
+/* Frames of one CapBuddy frame pool, which also holds the largest request */
+#define MCMC_MODEL_POOL_ORDER  MCMC_MAX_ORDER
+#define MCMC_MODEL_POOL_FRAMES (1u << MCMC_MODEL_POOL_ORDER)
+
+enum {
+    MCMC_MODEL_CASCADING,
+    MCMC_MODEL_CASCADING_BULK,
+    MCMC_MODEL_CAPBUDDY,
+    MCMC_MODELS
+};
+
+extern const char *const mcmc_model_names[MCMC_MODELS];
+
+typedef struct mcmc_model_stats {
+    uint64_t splits;
+    uint64_t merges;
+    /* modelled kernel invocations (retype, revoke) */
+    uint64_t invocations;
+    /* cslots in use, and the most that were in use at the same time */
+    uint64_t slots;
+    uint64_t peak_slots;
+    /* frames held by allocated blocks, and their peak */
+    uint64_t live_frames;
+    uint64_t peak_live_frames;
+} mcmc_model_stats_t;
+
+typedef struct mcmc_model {
+    int kind;
+    /* frames retyped by one invocation in cascading-bulk and capbuddy */
+    uint32_t fan_out;
+    uint32_t frames;
+    /* largest order that any block of the pool can reach */
+    int max_order;
+    /* head of the free list of every order, UINT32_MAX if empty */
+    uint32_t free_head[MCMC_MODEL_MAX_ORDER + 1];
+    /* per frame: order of the free block starting at it, or -1 */
+    int8_t *free_order;
+    /* per frame: free list links of the free block starting at it */
+    uint32_t *next;
+    uint32_t *prev;
+    /* capbuddy: number of frame pools */
+    uint32_t pools;
+    /* per pool: largest free order in the subtree of every node of its buddy tree, or -1 */
+    int8_t *pool_tree;
+    /* per pool: frames allocated from it, a pool is active while it has any */
+    uint32_t *pool_live;
+    mcmc_model_stats_t stats;
+} mcmc_model_t;
+
+/**
+ * Set up a pool of 'frames' frames, carved into the largest naturally
+ * aligned blocks it holds, as bootinfo hands out untypeds (or into frame
+ * pools, for capbuddy).
+ *
+ * @return 0 on success, -1 if out of host memory or 'frames' is 0 (or
+ *         less than a frame pool, for capbuddy).
+ */
+int mcmc_model_init(mcmc_model_t *model, int kind, uint32_t frames, uint32_t fan_out);
+
+void mcmc_model_destroy(mcmc_model_t *model);
+
+/**
+ * Allocate a memory unit of 'frame_count' frames.
+ *
+ * @return the first frame of its block, or -1 if no block is large enough.
+ */
+int64_t mcmc_model_alloc(mcmc_model_t *model, uint32_t frame_count);
+
+/* Free the memory unit of 'frame_count' frames at 'block' */
+void mcmc_model_free(mcmc_model_t *model, uint32_t block, uint32_t frame_count);
+
+/* @return true if the pool is back to the blocks (or inactive frame pools) it started with */
+bool mcmc_model_clean(const mcmc_model_t *model);
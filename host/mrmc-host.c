@@ -0,0 +1,409 @@
+/***
+ * Copyright 2023, zhuguangtao@iie.ac.cn, SKLOIS
+ *
+ * Native host driver of the MR-MC simulation.
+ *
+ * Runs the workload and the driver loop of test/mce.c (the same request
+ * streams, size policies, expiry wheel, free epochs, traces and sweep
+ * grids) against the allocator models of model.h, at full host speed. With the
+ * same seed, a run sees exactly the requests that the single worker of the
+ * rootserver sees, so as configurations can be pruned here before they are
+ * run under seL4. One CSV row is printed per allocator and grid point.
+ */
+#include <errno.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <mcmc/wheel.h>
+#include <mcmc/driver.h>
+#include <mcmc/slab.h>
+#include <mcmc/dist.h>
+#include <mcmc/trace.h>
+#include <mcmc/rng.h>
+#include <mcmc/sweep.h>
+#include <mcmc/workload.h>
+#include "model.h"
+
+/* Defaults of the rootserver, see mce.c */
+#define MCMC_ITERATION_TIME 80000
+#define MCMC_FREE_FREQUENCY 80
+/* The 112 MiB of untyped memory of the QEMU bcm2837 (raspi3) example */
+#define MCMC_HOST_MEMORY_FRAMES 28672
+#define MCMC_HOST_FAN_OUT 1024
+
+#define MCMC_STR(x)  #x
+#define MCMC_XSTR(x) MCMC_STR(x)
+
+typedef struct mcmc_host_unit {
+    /* must be the first member, see mcmc_wheel_node_t */
+    mcmc_wheel_node_t node;
+    uint32_t block;
+    uint32_t frames;
+} mcmc_host_unit_t;
+
+typedef struct mcmc_host_result {
+    uint32_t iterations;
+    uint64_t requests;
+    uint64_t total_frames;
+    bool failed;
+    bool clean;
+    /* see mcmc_driver_stats_t */
+    uint64_t epochs;
+    uint64_t max_epoch_units;
+    double seconds;
+} mcmc_host_result_t;
+
+static mcmc_dist_t mcmc_size_dist;
+static const mcmc_trace_header_t *mcmc_trace;
+/* MRMCFreeEpochLength, 0 frees units in the iteration they expire at */
+static uint32_t mcmc_host_free_epoch;
+
+static double mcmc_host_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* State of one run, the cookie of the driver callbacks */
+typedef struct mcmc_host_ctx {
+    mcmc_model_t *model;
+    mcmc_slab_t slab;
+    mcmc_rng_t rng;
+    uint32_t free_frequency;
+    /* next record of the replayed trace, or iteration of the last random request */
+    size_t cursor;
+} mcmc_host_ctx_t;
+
+/* See mcmc_request_next of mce.c */
+static bool mcmc_host_next(void *cookie, uint32_t i, mcmc_trace_record_t *req)
+{
+    mcmc_host_ctx_t *ctx = cookie;
+
+    if (mcmc_trace) {
+        const mcmc_trace_record_t *record = &mcmc_trace_records(mcmc_trace)[ctx->cursor];
+
+        if (ctx->cursor == mcmc_trace->records || record->iteration != i) {
+            return false;
+        }
+        *req = *record;
+        ctx->cursor++;
+        return true;
+    }
+    /* Exactly one random request per iteration */
+    if (ctx->cursor == i) {
+        return false;
+    }
+    ctx->cursor = i;
+    mcmc_workload_draw(&ctx->rng, &mcmc_size_dist, ctx->free_frequency, i, req);
+    return true;
+}
+
+/* A request that the model cannot satisfy fails, like an allocation error does */
+static int mcmc_host_alloc(void *cookie, uint32_t i, const mcmc_trace_record_t *req,
+                           mcmc_wheel_node_t **node, size_t *frames)
+{
+    mcmc_host_ctx_t *ctx = cookie;
+    mcmc_host_unit_t *unit = mcmc_slab_alloc(&ctx->slab);
+    int64_t block = unit ? mcmc_model_alloc(ctx->model, req->frames) : -1;
+
+    (void)i;
+    if (block < 0) {
+        if (unit) {
+            mcmc_slab_free(&ctx->slab, unit);
+        }
+        return ENOMEM;
+    }
+    unit->block = block;
+    unit->frames = req->frames;
+    *node = &unit->node;
+    *frames = 1u << mcmc_frame_order(req->frames);
+    return 0;
+}
+
+static size_t mcmc_host_expire(void *cookie, mcmc_wheel_node_t *node)
+{
+    mcmc_host_ctx_t *ctx = cookie;
+    mcmc_host_unit_t *unit = (mcmc_host_unit_t *)node;
+    int order = mcmc_frame_order(unit->frames);
+
+    mcmc_model_free(ctx->model, unit->block, unit->frames);
+    mcmc_slab_free(&ctx->slab, unit);
+    return 1u << order;
+}
+
+static const mcmc_driver_ops_t mcmc_host_ops = {
+    .next = mcmc_host_next,
+    .alloc = mcmc_host_alloc,
+    .expire = mcmc_host_expire,
+};
+
+/**
+ * One run of mcmc_exp_simulation, through the same driver loop. A request
+ * that the model cannot satisfy ends the run, everything still outstanding
+ * is given back afterwards, as the sweep teardown of mce.c does.
+ */
+static int mcmc_host_run(mcmc_model_t *model, const mcmc_sweep_point_t *point, mcmc_host_result_t *result)
+{
+    static mcmc_driver_t driver;
+    mcmc_host_ctx_t ctx = { .model = model, .free_frequency = point->free_frequency };
+    size_t live_units = point->free_frequency;
+    uint32_t iterations = point->iterations;
+    void *mem;
+
+    if (mcmc_trace) {
+        live_units = mcmc_trace->max_live_units;
+        iterations = mcmc_trace->iterations;
+    }
+    if (mcmc_host_free_epoch) {
+        /* Queued units keep their bookkeeping, see mcmc_epoch_slack of mce.c */
+        live_units += mcmc_trace ? mcmc_trace->records : mcmc_host_free_epoch;
+    }
+    mem = malloc(mcmc_slab_bytes(sizeof(mcmc_host_unit_t), live_units));
+    if (mem == NULL) {
+        return -1;
+    }
+    mcmc_slab_init(&ctx.slab, mem, sizeof(mcmc_host_unit_t), live_units);
+    /* Worker 0 of the rootserver draws from stream 0 */
+    mcmc_rng_seed(&ctx.rng, point->seed, 0);
+    mcmc_driver_init(&driver, &mcmc_host_ops, &ctx, mcmc_host_free_epoch, false);
+    memset(result, 0, sizeof(*result));
+
+    double start = mcmc_host_now();
+
+    result->failed = mcmc_driver_run(&driver, iterations) != 0;
+    result->seconds = mcmc_host_now() - start;
+    result->iterations = driver.stats.iterations;
+    result->requests = driver.stats.requests;
+    result->total_frames = driver.stats.total_frames;
+    result->epochs = driver.stats.epochs;
+    result->max_epoch_units = driver.stats.max_epoch_units;
+
+    for (mcmc_wheel_node_t *tf = mcmc_driver_drain(&driver); tf;)
+    {
+        mcmc_wheel_node_t *node = tf;
+
+        tf = tf->next;
+        mcmc_host_expire(&ctx, node);
+    }
+    result->clean = ctx.slab.in_use == 0 && model->stats.live_frames == 0 && mcmc_model_clean(model);
+    free(mem);
+    return 0;
+}
+
+static void *mcmc_host_read(const char *path, size_t *size)
+{
+    FILE *file = fopen(path, "rb");
+    void *data = NULL;
+    long length;
+
+    if (file == NULL) {
+        return NULL;
+    }
+    if (fseek(file, 0, SEEK_END) == 0 && (length = ftell(file)) > 0 && fseek(file, 0, SEEK_SET) == 0) {
+        data = malloc(length);
+        if (data && fread(data, 1, length, file) != (size_t)length) {
+            free(data);
+            data = NULL;
+        }
+        *size = length;
+    }
+    fclose(file);
+    return data;
+}
+
+/* Parse a "name,name,..." list of allocator models into a bit mask */
+static int mcmc_host_models(const char *spec, unsigned *mask)
+{
+    mcmc_sweep_t list;
+
+    if (mcmc_sweep_parse(&list, 0, spec, mcmc_model_names, MCMC_MODELS, 0)) {
+        return -1;
+    }
+    *mask = 0;
+    for (size_t m = 0; m < list.counts[0]; ++m)
+    {
+        *mask |= 1u << list.values[0][m];
+    }
+    return 0;
+}
+
+static void mcmc_host_usage(const char *prog)
+{
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  -a, --allocators LIST        cascading,cascading-bulk,capbuddy (default: all)\n"
+            "  -p, --policies LIST          uniform-pow2 | uniform | inverse-pow2 | table (default: uniform-pow2)\n"
+            "  -f, --free-frequencies LIST  (default: %u)\n"
+            "  -n, --iterations LIST        (default: %u)\n"
+            "  -s, --seeds LIST             (default: 0x%llx)\n"
+            "  -t, --size-table SPEC        frames:weight,... for the table policy\n"
+            "  -r, --trace FILE             replay a trace instead (see tools/mrmc-trace.py)\n"
+            "  -m, --memory-frames N        frames of untyped memory in the pool, capbuddy takes whole frame\n"
+            "                               pools of %u frames out of them (default: %u)\n"
+            "  -F, --fan-out N              KernelRetypeFanOutLimit for cascading-bulk and capbuddy (default: %u)\n"
+            "  -e, --free-epoch N           free expired units in batches every N iterations (default: 0, off)\n",
+            prog, MCMC_FREE_FREQUENCY, MCMC_ITERATION_TIME, MCMC_RNG_SEED,
+            MCMC_MODEL_POOL_FRAMES, MCMC_HOST_MEMORY_FRAMES, MCMC_HOST_FAN_OUT);
+}
+
+int main(int argc, char **argv)
+{
+    static const struct option options[] = {
+        { "allocators", required_argument, NULL, 'a' },
+        { "policies", required_argument, NULL, 'p' },
+        { "free-frequencies", required_argument, NULL, 'f' },
+        { "iterations", required_argument, NULL, 'n' },
+        { "seeds", required_argument, NULL, 's' },
+        { "size-table", required_argument, NULL, 't' },
+        { "trace", required_argument, NULL, 'r' },
+        { "memory-frames", required_argument, NULL, 'm' },
+        { "fan-out", required_argument, NULL, 'F' },
+        { "free-epoch", required_argument, NULL, 'e' },
+        { "help", no_argument, NULL, 'h' },
+        { NULL, 0, NULL, 0 }
+    };
+    /* The seed is MCMC_RNG_SEED */
+    const char *specs[MCMC_SWEEP_AXES] = {
+        "uniform-pow2", MCMC_XSTR(MCMC_FREE_FREQUENCY), MCMC_XSTR(MCMC_ITERATION_TIME), "0x4d524d43"
+    };
+    const char *table = NULL;
+    const char *trace_path = NULL;
+    unsigned models = (1u << MCMC_MODELS) - 1;
+    unsigned long memory_frames = MCMC_HOST_MEMORY_FRAMES;
+    unsigned long fan_out = MCMC_HOST_FAN_OUT;
+    mcmc_sweep_t sweep;
+    int opt;
+
+    while ((opt = getopt_long(argc, argv, "a:p:f:n:s:t:r:m:F:e:h", options, NULL)) != -1)
+    {
+        switch (opt) {
+        case 'a':
+            if (mcmc_host_models(optarg, &models)) {
+                fprintf(stderr, "invalid allocator list '%s'\n", optarg);
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'p':
+            specs[MCMC_SWEEP_POLICY] = optarg;
+            break;
+        case 'f':
+            specs[MCMC_SWEEP_FREE_FREQUENCY] = optarg;
+            break;
+        case 'n':
+            specs[MCMC_SWEEP_ITERATIONS] = optarg;
+            break;
+        case 's':
+            specs[MCMC_SWEEP_SEED] = optarg;
+            break;
+        case 't':
+            table = optarg;
+            break;
+        case 'r':
+            trace_path = optarg;
+            break;
+        case 'm':
+            memory_frames = strtoul(optarg, NULL, 0);
+            break;
+        case 'F':
+            fan_out = strtoul(optarg, NULL, 0);
+            break;
+        case 'e':
+            mcmc_host_free_epoch = strtoul(optarg, NULL, 0);
+            break;
+        default:
+            mcmc_host_usage(argv[0]);
+            return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+    if (memory_frames == 0 || memory_frames > UINT32_MAX || fan_out == 0 || fan_out > UINT32_MAX) {
+        fprintf(stderr, "invalid memory frames or fan-out\n");
+        return EXIT_FAILURE;
+    }
+    if (models & (1u << MCMC_MODEL_CAPBUDDY)) {
+        if (memory_frames < MCMC_MODEL_POOL_FRAMES) {
+            fprintf(stderr, "capbuddy needs at least %u memory frames, one frame pool\n", MCMC_MODEL_POOL_FRAMES);
+            return EXIT_FAILURE;
+        }
+        if (memory_frames % MCMC_MODEL_POOL_FRAMES) {
+            fprintf(stderr, "capbuddy ignores the last %lu memory frames, less than a frame pool of %u\n",
+                    memory_frames % MCMC_MODEL_POOL_FRAMES, MCMC_MODEL_POOL_FRAMES);
+        }
+    }
+    /* Same bounds as the MRMCSweep* lists of the rootserver */
+    if (mcmc_sweep_parse(&sweep, MCMC_SWEEP_POLICY, specs[MCMC_SWEEP_POLICY],
+                         mcmc_policy_names, MCMC_POLICIES, 0) ||
+        mcmc_sweep_parse(&sweep, MCMC_SWEEP_FREE_FREQUENCY, specs[MCMC_SWEEP_FREE_FREQUENCY], NULL, 0, 2) ||
+        mcmc_sweep_parse(&sweep, MCMC_SWEEP_ITERATIONS, specs[MCMC_SWEEP_ITERATIONS], NULL, 0, 1) ||
+        mcmc_sweep_parse(&sweep, MCMC_SWEEP_SEED, specs[MCMC_SWEEP_SEED], NULL, 0, 0)) {
+        fprintf(stderr, "invalid parameter list\n");
+        return EXIT_FAILURE;
+    }
+    if (trace_path) {
+        size_t size = 0;
+        void *data = mcmc_host_read(trace_path, &size);
+
+        mcmc_trace = data ? mcmc_trace_check(data, size, MCMC_MAX_FRAME_COUNT) : NULL;
+        if (mcmc_trace == NULL) {
+            fprintf(stderr, "invalid trace '%s': %s\n", trace_path, data ? "bad format" : strerror(errno));
+            return EXIT_FAILURE;
+        }
+        /* The trace fixes every parameter of the run */
+        for (int axis = 0; axis < MCMC_SWEEP_AXES; ++axis)
+        {
+            sweep.counts[axis] = 1;
+            sweep.values[axis][0] = 0;
+        }
+    }
+
+    printf("allocator,policy,free_frequency,iterations,seed,free_epoch,completed,requests,total_frames,failed,clean,"
+           "peak_live_frames,splits,merges,invocations,peak_slots,epochs,max_epoch_units,ns_per_request\n");
+
+    size_t points = mcmc_sweep_points(&sweep);
+    int unclean = 0;
+
+    for (size_t p = 0; p < points; ++p)
+    {
+        mcmc_sweep_point_t point;
+
+        mcmc_sweep_point(&sweep, p, &point);
+        if (!mcmc_trace && mcmc_workload_policy(&mcmc_size_dist, point.policy, table)) {
+            fprintf(stderr, "invalid size distribution of policy %s\n", mcmc_policy_names[point.policy]);
+            return EXIT_FAILURE;
+        }
+        for (int kind = 0; kind < MCMC_MODELS; ++kind)
+        {
+            mcmc_model_t model;
+            mcmc_host_result_t result;
+
+            if (!(models & (1u << kind))) {
+                continue;
+            }
+            /* The arguments are checked above, so only malloc fails here */
+            if (mcmc_model_init(&model, kind, memory_frames, fan_out) ||
+                mcmc_host_run(&model, &point, &result)) {
+                fprintf(stderr, "out of host memory\n");
+                return EXIT_FAILURE;
+            }
+            const mcmc_model_stats_t *stats = &model.stats;
+
+            printf("%s,%s,%u,%u,%u,%u,%u,%" PRIu64 ",%" PRIu64 ",%d,%d,"
+                   "%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%.1f\n",
+                   mcmc_model_names[kind], mcmc_trace ? "trace" : mcmc_policy_names[point.policy],
+                   mcmc_trace ? 0 : point.free_frequency, mcmc_trace ? mcmc_trace->iterations : point.iterations,
+                   mcmc_trace ? 0 : point.seed, mcmc_host_free_epoch, result.iterations, result.requests, result.total_frames,
+                   result.failed, result.clean, stats->peak_live_frames, stats->splits, stats->merges,
+                   stats->invocations, stats->peak_slots, result.epochs, result.max_epoch_units,
+                   result.requests ? result.seconds * 1e9 / result.requests : 0.0);
+            /* Running out of memory is a result, leaking it is a bug */
+            unclean += !result.clean;
+            mcmc_model_destroy(&model);
+        }
+    }
+    return unclean ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -125,6 +125,30 @@ if(NOT Sel4testAllowSettingsOverride)
         set(KernelMaxNumNodes 1 CACHE STRING "" FORCE)
     endif()
 
+    # Modes that read the cycle counter from user level: the latency histograms, the
+    # map-and-touch timings, the per-operation cycles of MCMC_OP_CYCLES, the per-run
+    # cycles of MCMC_RUN_CYCLES (see test/mce.c) and the clients of the memory server
+    set(MRMC_NEEDS_CYCLES OFF)
+    foreach(
+        option
+        IN
+        ITEMS
+        MRMCLatencyHistogram
+        MRMCMapTouch
+        MRMCScaling
+        MRMCObjectMix
+        MRMCReplicas
+        MRMCCalibrate
+        MRMCMemoryServer
+    )
+        if(${option})
+            set(MRMC_NEEDS_CYCLES ON)
+        endif()
+    endforeach()
+    if(MRMC_NEEDS_CYCLES AND KernelArchARM)
+        set(KernelArmExportPMUUser ON CACHE BOOL "" FORCE)
+    endif()
+
     if(MCS)
         set(KernelIsMCS ON CACHE BOOL "" FORCE)
     else()
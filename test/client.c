@@ -0,0 +1,206 @@
+/***
+ * Copyright 2023, zhuguangtao@iie.ac.cn, SKLOIS
+ *
+ * Client process of the memory server mode (MRMCMemoryServer), spawned by
+ * the rootserver from its CPIO archive, see mcmc/server.h.
+ *
+ * Every iteration draws one memory request, just as a worker of the
+ * in-process run draws it from the same stream, and queues it into the
+ * message registers, followed by the frees of the units which expire at
+ * that iteration. A full batch (and whatever is left at the end of the
+ * run) goes to the server in one seL4_Call. Once a batch is answered, the
+ * last frame granted by it is checked to be a page cap indeed. Everything
+ * is static, as the client has no heap with LibSel4MuslcSysMorecoreBytes=0.
+ */
+#include <autoconf.h>
+#include <sel4testcase-mce/gen_config.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sel4/sel4.h>
+#include <sel4bench/sel4bench.h>
+#include <utils/util.h>
+#include <mcmc/hist.h>
+#include <mcmc/server.h>
+#include <mcmc/wheel.h>
+#include <mcmc/workload.h>
+
+#if defined(CONFIG_ARCH_ARM)
+#define client_page_address seL4_ARM_Page_GetAddress
+#elif defined(CONFIG_ARCH_X86)
+#define client_page_address seL4_X86_Page_GetAddress
+#elif defined(CONFIG_ARCH_RISCV)
+#define client_page_address seL4_RISCV_Page_GetAddress
+#endif
+
+static seL4_CPtr client_endpoint;
+static seL4_CPtr client_slots;
+static uint32_t client_batch;
+
+/* one wheel node per handle, the handle of a unit is the index of its node */
+static mcmc_wheel_t client_wheel;
+static mcmc_wheel_node_t client_units[MCMC_CLIENT_MAX_HANDLES];
+/* handles of no outstanding unit, the last one is handed out next */
+static uint32_t client_handles[MCMC_CLIENT_MAX_HANDLES];
+static uint32_t client_free_handles;
+
+/* requests of the batch being queued, as the reply overwrites the message registers */
+static uint32_t client_ops[seL4_MsgMaxLength];
+static uint32_t client_pending;
+
+static mcmc_dist_t client_size_dist;
+/* see mcmc_client_stats_t */
+static mcmc_hist_t client_batch_latency;
+static mcmc_hist_t client_request_latency;
+static mcmc_client_stats_t client_stats;
+
+/**
+ * Send the queued requests and account them once they are answered. The
+ * cycle counter is only read, as the rootserver has set it up already.
+ *
+ * @return the first error of the batch.
+ */
+static int client_flush(void)
+{
+    seL4_MessageInfo_t info = seL4_MessageInfo_new(MCMC_SERVER_BATCH, 0, 0, client_pending);
+    uint32_t sent = client_pending;
+    int err = seL4_NoError;
+
+    if (sent == 0) {
+        return seL4_NoError;
+    }
+    client_pending = 0;
+    ccnt_t start = sel4bench_get_cycle_count();
+    info = seL4_Call(client_endpoint, info);
+    uint64_t latency = sel4bench_get_cycle_count() - start;
+
+    client_stats.batches++;
+    mcmc_hist_record(&client_batch_latency, latency);
+    mcmc_hist_record(&client_request_latency, latency / sent);
+    if (seL4_MessageInfo_get_length(info) != sent) {
+        return seL4_IllegalOperation;
+    }
+    /* handle of the last allocation of the batch still outstanding (none if MCMC_CLIENT_MAX_HANDLES) */
+    uint32_t granted = MCMC_CLIENT_MAX_HANDLES;
+    uint32_t granted_frame = 0;
+    for (uint32_t m = 0; m < sent; ++m)
+    {
+        seL4_Word status = seL4_GetMR(m);
+        uint32_t handle = mcmc_server_op_handle(client_ops[m]);
+
+        if (status != seL4_NoError) {
+            err = err ? err : (int)status;
+        } else if (client_ops[m] & MCMC_SERVER_FREE) {
+            client_stats.frees++;
+            if (handle == granted) {
+                granted = MCMC_CLIENT_MAX_HANDLES;
+            }
+        } else {
+            uint32_t frames = mcmc_server_op_frames(client_ops[m]);
+
+            client_stats.requests++;
+            client_stats.total_frames += frames;
+            granted = handle;
+            granted_frame = MIN(frames, MCMC_CLIENT_HANDLE_SLOTS) - 1;
+        }
+    }
+    /* One invocation per message at most, which only the cycles of the whole run take in */
+    if (err == seL4_NoError && granted < MCMC_CLIENT_MAX_HANDLES &&
+        client_page_address(client_slots + mcmc_client_frame_slot(granted, granted_frame)).error != seL4_NoError) {
+        err = seL4_FailedLookup;
+    }
+    return err;
+}
+
+static int client_queue(uint32_t op)
+{
+    client_ops[client_pending] = op;
+    seL4_SetMR(client_pending, op);
+    if (++client_pending == client_batch) {
+        return client_flush();
+    }
+    return seL4_NoError;
+}
+
+static int client_run(uint64_t seed, uint32_t stream, uint32_t iterations, uint32_t free_frequency)
+{
+    mcmc_rng_t rng;
+    mcmc_trace_record_t req;
+    int err = seL4_NoError;
+
+    if (free_frequency < 2 || free_frequency > MCMC_CLIENT_MAX_HANDLES) {
+        return seL4_RangeError;
+    }
+    mcmc_rng_seed(&rng, seed, stream);
+    /* Handle 0 is handed out first */
+    for (uint32_t h = 0; h < free_frequency; ++h)
+    {
+        client_handles[h] = free_frequency - 1 - h;
+    }
+    client_free_handles = free_frequency;
+    mcmc_wheel_init(&client_wheel, 0);
+
+    for (uint32_t i = 1; i <= iterations && err == seL4_NoError; ++i)
+    {
+        /* Units live for less than free_frequency iterations, so a handle is always left */
+        uint32_t handle = client_handles[--client_free_handles];
+
+        mcmc_workload_draw(&rng, &client_size_dist, free_frequency, i, &req);
+        client_units[handle].expiry = req.expiry;
+        mcmc_wheel_insert(&client_wheel, &client_units[handle]);
+        err = client_queue(mcmc_server_alloc_op(handle, req.frames));
+
+        mcmc_wheel_node_t *expired = mcmc_wheel_advance(&client_wheel);
+        while (expired && err == seL4_NoError)
+        {
+            handle = expired - client_units;
+            expired = expired->next;
+            client_handles[client_free_handles++] = handle;
+            err = client_queue(mcmc_server_free_op(handle));
+        }
+        if (err == seL4_NoError) {
+            client_stats.iterations = i;
+        }
+    }
+    if (err == seL4_NoError) {
+        err = client_flush();
+    }
+    return err;
+}
+
+int main(int argc, char **argv)
+{
+    int err = seL4_InvalidArgument;
+
+    mcmc_hist_init(&client_batch_latency);
+    mcmc_hist_init(&client_request_latency);
+    if (argc == MCMC_CLIENT_ARGS) {
+        client_endpoint = strtoul(argv[MCMC_CLIENT_ARG_ENDPOINT], NULL, 10);
+        client_slots = strtoul(argv[MCMC_CLIENT_ARG_SLOTS], NULL, 10);
+        client_batch = strtoul(argv[MCMC_CLIENT_ARG_BATCH], NULL, 10);
+        client_batch = MIN(MAX(client_batch, 1), seL4_MsgMaxLength);
+        if (mcmc_workload_policy(&client_size_dist, strtol(argv[MCMC_CLIENT_ARG_POLICY], NULL, 10),
+                                 CONFIG_MRMC_SIZE_TABLE) == 0) {
+            ccnt_t start = sel4bench_get_cycle_count();
+
+            err = client_run(strtoull(argv[MCMC_CLIENT_ARG_SEED], NULL, 10),
+                             strtoul(argv[MCMC_CLIENT_ARG_INDEX], NULL, 10),
+                             strtoul(argv[MCMC_CLIENT_ARG_ITERATIONS], NULL, 10),
+                             strtoul(argv[MCMC_CLIENT_ARG_FREE_FREQUENCY], NULL, 10));
+            client_stats.cycles = sel4bench_get_cycle_count() - start;
+        }
+    }
+    client_stats.error = err;
+    client_stats.round_trip_sum = client_batch_latency.sum;
+    client_stats.batch_p50 = mcmc_hist_quantile(&client_batch_latency, 50, 100);
+    client_stats.batch_p99 = mcmc_hist_quantile(&client_batch_latency, 99, 100);
+    client_stats.batch_max = client_batch_latency.max;
+    client_stats.request_p50 = mcmc_hist_quantile(&client_request_latency, 50, 100);
+    client_stats.request_p99 = mcmc_hist_quantile(&client_request_latency, 99, 100);
+    client_stats.request_max = client_request_latency.max;
+    /* Without an endpoint there is nobody to tell, and the client just faults */
+    memcpy(seL4_GetIPCBuffer()->msg, &client_stats, sizeof(client_stats));
+    seL4_Call(client_endpoint, seL4_MessageInfo_new(MCMC_SERVER_DONE, 0, 0,
+                                                    DIV_ROUND_UP(sizeof(client_stats), sizeof(seL4_Word))));
+    /* The server never answers, so as the client stays blocked for good */
+    return 0;
+}
@@ -0,0 +1,135 @@
+/***
+ * Copyright 2023, zhuguangtao@iie.ac.cn, SKLOIS
+ *
+ * Discrete size distributions for MR-MC memory requests.
+ */
+#include <stdlib.h>
+#include <mcmc/dist.h>
+
+#define DIST_PROB_ONE (1ull << 32)
+
+int mcmc_dist_build(mcmc_dist_t *dist, const uint32_t *values, const uint32_t *weights, size_t entries)
+{
+    /* Column indices, small ones grow from the front and large ones from the back */
+    static uint16_t worklist[MCMC_DIST_MAX_ENTRIES];
+    static uint64_t scaled[MCMC_DIST_MAX_ENTRIES];
+    uint64_t total = 0;
+    size_t small = 0;
+    size_t large = entries;
+
+    if (entries == 0 || entries > MCMC_DIST_MAX_ENTRIES) {
+        return -1;
+    }
+    for (size_t i = 0; i < entries; ++i)
+    {
+        total += weights[i];
+    }
+    if (total == 0 || total > MCMC_DIST_MAX_WEIGHT) {
+        return -1;
+    }
+    dist->entries = entries;
+    dist->max_value = 0;
+    /**
+     * Scale every weight by the number of columns, so as a column which
+     * is exactly full holds 'total' and the comparisons stay integral.
+     */
+    for (size_t i = 0; i < entries; ++i)
+    {
+        dist->values[i] = values[i];
+        if (values[i] > dist->max_value) {
+            dist->max_value = values[i];
+        }
+        scaled[i] = (uint64_t)weights[i] * entries;
+        if (scaled[i] < total) {
+            worklist[small++] = i;
+        } else {
+            worklist[--large] = i;
+        }
+    }
+    /**
+     * Vose's method: top every underfull column up with the excess of an
+     * overfull one, which may in turn become underfull itself.
+     */
+    while (small > 0 && large < entries)
+    {
+        uint16_t s = worklist[--small];
+        uint16_t l = worklist[large];
+
+        dist->prob[s] = (scaled[s] << 32) / total;
+        dist->alias[s] = l;
+        scaled[l] = scaled[l] + scaled[s] - total;
+        if (scaled[l] < total) {
+            large++;
+            worklist[small++] = l;
+        }
+    }
+    /* Whatever is left is full up to rounding */
+    while (small > 0)
+    {
+        uint16_t s = worklist[--small];
+        dist->prob[s] = DIST_PROB_ONE;
+        dist->alias[s] = s;
+    }
+    for (; large < entries; ++large)
+    {
+        uint16_t l = worklist[large];
+        dist->prob[l] = DIST_PROB_ONE;
+        dist->alias[l] = l;
+    }
+    return 0;
+}
+
+int mcmc_dist_parse(mcmc_dist_t *dist, const char *spec, uint32_t max_value)
+{
+    static uint32_t values[MCMC_DIST_MAX_ENTRIES];
+    static uint32_t weights[MCMC_DIST_MAX_ENTRIES];
+    size_t entries = 0;
+    const char *p = spec;
+    char *end;
+
+    while (*p)
+    {
+        if (entries == MCMC_DIST_MAX_ENTRIES) {
+            return -1;
+        }
+        unsigned long value = strtoul(p, &end, 0);
+        unsigned long weight = 1;
+
+        if (end == p || value == 0 || value > max_value) {
+            return -1;
+        }
+        p = end;
+        if (*p == ':') {
+            weight = strtoul(++p, &end, 0);
+            if (end == p || weight > MCMC_DIST_MAX_WEIGHT) {
+                return -1;
+            }
+            p = end;
+        }
+        values[entries] = value;
+        weights[entries] = weight;
+        entries++;
+
+        if (*p == ',') {
+            p++;
+        } else if (*p) {
+            return -1;
+        }
+    }
+    return mcmc_dist_build(dist, values, weights, entries);
+}
+
+uint64_t mcmc_dist_mean(const mcmc_dist_t *dist)
+{
+    uint64_t sum = 0;
+
+    /* Every column is drawn alike, and yields its value or its alias's */
+    for (size_t c = 0; c < dist->entries; ++c)
+    {
+        uint64_t accept = dist->prob[c] >> 16;
+        uint64_t reject = (DIST_PROB_ONE >> 16) - accept;
+
+        sum += (dist->values[c] * accept + dist->values[dist->alias[c]] * reject) >> (16 - MCMC_DIST_MEAN_SHIFT);
+    }
+    return sum / dist->entries;
+}
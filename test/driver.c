@@ -0,0 +1,151 @@
+/***
+ * Copyright 2023, zhuguangtao@iie.ac.cn, SKLOIS
+ *
+ * Driver loop of the MR-MC simulation.
+ */
+#include <string.h>
+#include <mcmc/driver.h>
+
+#define DRIVER_MAX(a, b) ((a) > (b) ? (a) : (b))
+
+void mcmc_driver_init(mcmc_driver_t *drv, const mcmc_driver_ops_t *ops, void *cookie,
+                      uint32_t free_epoch, bool count_failures)
+{
+    memset(drv, 0, sizeof(*drv));
+    drv->ops = ops;
+    drv->cookie = cookie;
+    drv->free_epoch = free_epoch;
+    drv->count_failures = count_failures;
+    drv->deferred_tail = &drv->deferred;
+}
+
+/* Free a NULL-terminated list of expired units, in list order */
+static void driver_expire(mcmc_driver_t *drv, mcmc_wheel_node_t *expired)
+{
+    while (expired)
+    {
+        mcmc_wheel_node_t *node = expired;
+
+        expired = expired->next;
+        drv->footprint -= drv->ops->expire(drv->cookie, node);
+    }
+}
+
+static void driver_epoch_defer(mcmc_driver_t *drv, mcmc_wheel_node_t *expired)
+{
+    for (; expired; expired = expired->next)
+    {
+        *drv->deferred_tail = expired;
+        drv->deferred_tail = &expired->next;
+        drv->deferred_count++;
+    }
+}
+
+/* Free every queued unit, as one batch, at the end of the epoch at 'i' */
+static void driver_epoch_release(mcmc_driver_t *drv, uint32_t i)
+{
+    mcmc_wheel_node_t *deferred = drv->deferred;
+
+    if (drv->deferred_count == 0) {
+        return;
+    }
+    drv->stats.epochs++;
+    drv->stats.max_epoch_units = DRIVER_MAX(drv->stats.max_epoch_units, drv->deferred_count);
+    drv->deferred = NULL;
+    drv->deferred_tail = &drv->deferred;
+    drv->deferred_count = 0;
+    driver_expire(drv, deferred);
+    if (drv->ops->epoch) {
+        drv->ops->epoch(drv->cookie, i);
+    }
+}
+
+int mcmc_driver_run(mcmc_driver_t *drv, uint32_t iterations)
+{
+    const mcmc_driver_ops_t *ops = drv->ops;
+    mcmc_driver_stats_t *stats = &drv->stats;
+    mcmc_trace_record_t req;
+    uint32_t i = 1;
+
+    memset(stats, 0, sizeof(*stats));
+    drv->footprint = 0;
+    drv->deferred = NULL;
+    drv->deferred_tail = &drv->deferred;
+    drv->deferred_count = 0;
+    /* The wheel starts right before the first iteration */
+    mcmc_wheel_init(&drv->wheel, i - 1);
+
+    for (; i <= iterations; ++i)
+    {
+        while (ops->next(drv->cookie, i, &req))
+        {
+            mcmc_wheel_node_t *node;
+            size_t frames;
+            int err = ops->alloc(drv->cookie, i, &req, &node, &frames);
+
+            if (err) {
+                if (drv->count_failures) {
+                    /* Drop the request and go on */
+                    if (stats->failures++ == 0) {
+                        stats->first_failure = i;
+                    }
+                    continue;
+                }
+                stats->iterations = i - 1;
+                stats->error = err;
+                return err;
+            }
+            node->expiry = req.expiry;
+            mcmc_wheel_insert(&drv->wheel, node);
+            stats->requests++;
+            if (frames) {
+                stats->total_frames += req.frames;
+                drv->footprint += frames;
+                stats->peak_footprint = DRIVER_MAX(stats->peak_footprint, drv->footprint);
+            }
+            stats->peak_units = DRIVER_MAX(stats->peak_units, mcmc_driver_outstanding(drv));
+        }
+        /* Only units expiring at 'i' are visited */
+        mcmc_wheel_node_t *expired = mcmc_wheel_advance(&drv->wheel);
+
+        if (drv->free_epoch == 0) {
+            driver_expire(drv, expired);
+        } else {
+            driver_epoch_defer(drv, expired);
+            if (i % drv->free_epoch == 0) {
+                driver_epoch_release(drv, i);
+            }
+        }
+        stats->footprint_sum += drv->footprint;
+        if (ops->sample) {
+            ops->sample(drv->cookie, i, mcmc_driver_outstanding(drv), drv->footprint);
+        }
+    }
+    /* The last epoch ends with the run */
+    driver_epoch_release(drv, i - 1);
+    stats->iterations = i - 1;
+    return 0;
+}
+
+mcmc_wheel_node_t *mcmc_driver_drain(mcmc_driver_t *drv)
+{
+    mcmc_wheel_node_t *list = drv->deferred;
+    mcmc_wheel_node_t **tail = list ? drv->deferred_tail : &list;
+
+    while (drv->wheel.pending)
+    {
+        mcmc_wheel_node_t *expired = mcmc_wheel_advance(&drv->wheel);
+
+        for (; expired; expired = expired->next)
+        {
+            *tail = expired;
+            tail = &expired->next;
+        }
+    }
+    *tail = NULL;
+    drv->deferred = NULL;
+    drv->deferred_tail = &drv->deferred;
+    drv->deferred_count = 0;
+    drv->footprint = 0;
+    return list;
+}
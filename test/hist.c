@@ -0,0 +1,86 @@
+/***
+ * Copyright 2023, zhuguangtao@iie.ac.cn, SKLOIS
+ *
+ * Log-bucketed latency histograms for MR-MC.
+ */
+#include <string.h>
+#include <mcmc/hist.h>
+
+static unsigned hist_bucket(uint64_t value)
+{
+    if (value < MCMC_HIST_SUB_BUCKETS) {
+        return value;
+    }
+    unsigned exp = 63 - __builtin_clzll(value);
+    unsigned sub = (value >> (exp - MCMC_HIST_SUB_BITS)) & (MCMC_HIST_SUB_BUCKETS - 1);
+
+    return MCMC_HIST_SUB_BUCKETS * (exp - MCMC_HIST_SUB_BITS + 1) + sub;
+}
+
+static uint64_t hist_bucket_upper(unsigned bucket)
+{
+    if (bucket < MCMC_HIST_SUB_BUCKETS) {
+        return bucket;
+    }
+    unsigned shift = bucket / MCMC_HIST_SUB_BUCKETS - 1;
+    uint64_t base = MCMC_HIST_SUB_BUCKETS + bucket % MCMC_HIST_SUB_BUCKETS;
+
+    return ((base + 1) << shift) - 1;
+}
+
+void mcmc_hist_init(mcmc_hist_t *hist)
+{
+    memset(hist, 0, sizeof(*hist));
+    hist->min = UINT64_MAX;
+}
+
+void mcmc_hist_record(mcmc_hist_t *hist, uint64_t value)
+{
+    hist->buckets[hist_bucket(value)]++;
+    hist->count++;
+    hist->sum += value;
+    if (value < hist->min) {
+        hist->min = value;
+    }
+    if (value > hist->max) {
+        hist->max = value;
+    }
+}
+
+uint64_t mcmc_hist_quantile(const mcmc_hist_t *hist, uint64_t num, uint64_t den)
+{
+    uint64_t rank = (hist->count * num + den - 1) / den;
+    uint64_t seen = 0;
+
+    if (hist->count == 0) {
+        return 0;
+    }
+    if (rank == 0) {
+        rank = 1;
+    }
+    for (unsigned i = 0; i < MCMC_HIST_BUCKETS; ++i)
+    {
+        seen += hist->buckets[i];
+        if (seen >= rank) {
+            uint64_t upper = hist_bucket_upper(i);
+            return upper < hist->max ? upper : hist->max;
+        }
+    }
+    return hist->max;
+}
+
+void mcmc_hist_merge(mcmc_hist_t *hist, const mcmc_hist_t *other)
+{
+    for (unsigned i = 0; i < MCMC_HIST_BUCKETS; ++i)
+    {
+        hist->buckets[i] += other->buckets[i];
+    }
+    hist->count += other->count;
+    hist->sum += other->sum;
+    if (other->min < hist->min) {
+        hist->min = other->min;
+    }
+    if (other->max > hist->max) {
+        hist->max = other->max;
+    }
+}
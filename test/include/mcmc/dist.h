@@ -0,0 +1,68 @@
+/***
+ * Copyright 2023, zhuguangtao@iie.ac.cn, SKLOIS
+ *
+ * Discrete size distributions for MR-MC memory requests.
+ *
+ * A distribution is a table of (value, weight) pairs, turned into an alias
+ * table (Vose's method) when it is built, so as drawing one value costs a
+ * single random word, a multiplication and a comparison no matter how many
+ * entries the table has. Build it before the timed region.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define MCMC_DIST_MAX_ENTRIES   1024
+/* Keeps (total weight * entries) within 32 bits for the fixed-point build */
+#define MCMC_DIST_MAX_WEIGHT    (1u << 22)
+
+typedef struct mcmc_dist {
+    size_t entries;
+    uint32_t max_value;
+    uint32_t values[MCMC_DIST_MAX_ENTRIES];
+    /* acceptance threshold of every column, in units of 2^-32 */
+    uint64_t prob[MCMC_DIST_MAX_ENTRIES];
+    /* column taken when the threshold is not met */
+    uint16_t alias[MCMC_DIST_MAX_ENTRIES];
+} mcmc_dist_t;
+
+/**
+ * Build the alias table of 'entries' (values[i], weights[i]) pairs.
+ * Zero weights are allowed, as long as the total weight is positive and
+ * does not exceed MCMC_DIST_MAX_WEIGHT.
+ *
+ * @return 0 on success, -1 if the table is empty, too large or overweight.
+ */
+int mcmc_dist_build(mcmc_dist_t *dist, const uint32_t *values, const uint32_t *weights, size_t entries);
+
+/**
+ * Build a distribution from a "value:weight,value:weight,..." string,
+ * a missing ":weight" counts as weight 1. Values must be in [1, max_value].
+ *
+ * @return 0 on success, -1 on a malformed specification.
+ */
+int mcmc_dist_parse(mcmc_dist_t *dist, const char *spec, uint32_t max_value);
+
+/* Fractional bits of mcmc_dist_mean */
+#define MCMC_DIST_MEAN_SHIFT    10
+
+/**
+ * Mean value of the distribution, in fixed point with MCMC_DIST_MEAN_SHIFT
+ * fractional bits (exact to about 2^-16 of the mean).
+ */
+uint64_t mcmc_dist_mean(const mcmc_dist_t *dist);
+
+/**
+ * Draw one value with a 64-bit random word: the upper half picks the
+ * column, the lower half decides between the column and its alias.
+ */
+static inline uint32_t mcmc_dist_sample(const mcmc_dist_t *dist, uint64_t rnd)
+{
+    size_t column = (size_t)(((rnd >> 32) * dist->entries) >> 32);
+
+    if ((rnd & 0xffffffffu) < dist->prob[column]) {
+        return dist->values[column];
+    }
+    return dist->values[dist->alias[column]];
+}
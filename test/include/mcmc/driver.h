@@ -0,0 +1,111 @@
+/***
+ * Copyright 2023, zhuguangtao@iie.ac.cn, SKLOIS
+ *
+ * Driver loop of the MR-MC simulation, shared by the rootserver (mce.c) and
+ * the native host build (host/mrmc-host.c).
+ *
+ * Every iteration first allocates the requests of that iteration, then
+ * frees the units which expire at it, either right away or, with a free
+ * epoch, queued until the end of the epoch and then freed in one batch.
+ * Where requests come from and what allocating and freeing a unit means
+ * is up to the callbacks, the driver only keeps the expiry wheel, the free
+ * epoch queue and the figures of the run.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <mcmc/trace.h>
+#include <mcmc/wheel.h>
+
+typedef struct mcmc_driver_ops {
+    /**
+     * Fetch the next request of iteration 'i' into 'req'.
+     *
+     * @return false once iteration 'i' has no more requests.
+     */
+    bool (*next)(void *cookie, uint32_t i, mcmc_trace_record_t *req);
+    /**
+     * Allocate a memory unit for 'req' at iteration 'i'. On success '*node'
+     * is the wheel node of the unit, which the driver schedules to expire
+     * at 'req->expiry', and '*frames' the frames its block holds (0 for
+     * units that are not part of the footprint).
+     *
+     * @return 0, or the error which failed the request.
+     */
+    int (*alloc)(void *cookie, uint32_t i, const mcmc_trace_record_t *req, mcmc_wheel_node_t **node, size_t *frames);
+    /**
+     * Free the unit of an expired wheel node.
+     *
+     * @return the frames its block held.
+     */
+    size_t (*expire)(void *cookie, mcmc_wheel_node_t *node);
+    /* Optional, called after the frees of every iteration */
+    void (*sample)(void *cookie, uint32_t i, size_t units, size_t frames);
+    /* Optional, called after every batch of queued units is freed, at the end of the epoch at 'i' */
+    void (*epoch)(void *cookie, uint32_t i);
+} mcmc_driver_ops_t;
+
+typedef struct mcmc_driver_stats {
+    /* iterations completed */
+    uint32_t iterations;
+    uint64_t requests;
+    uint64_t total_frames;
+    /* 0, or the error of the request which ended the run */
+    int error;
+    /* most frames held by outstanding units, queued ones included, and their sum over all iterations */
+    size_t peak_footprint;
+    uint64_t footprint_sum;
+    /* most units outstanding at once, queued ones included */
+    size_t peak_units;
+    /* batches of queued units freed, and the most units of one of them */
+    uint64_t epochs;
+    size_t max_epoch_units;
+    /* with 'count_failures': failed requests, and the iteration of the first one */
+    uint64_t failures;
+    uint32_t first_failure;
+} mcmc_driver_stats_t;
+
+typedef struct mcmc_driver {
+    const mcmc_driver_ops_t *ops;
+    void *cookie;
+    /* iterations per free epoch, 0 frees units in the iteration they expire at */
+    uint32_t free_epoch;
+    /* drop failed requests and go on, instead of ending the run */
+    bool count_failures;
+    mcmc_wheel_t wheel;
+    /* expired units waiting for the end of the epoch, oldest first */
+    mcmc_wheel_node_t *deferred;
+    mcmc_wheel_node_t **deferred_tail;
+    size_t deferred_count;
+    /* frames held by the blocks of all outstanding units */
+    size_t footprint;
+    mcmc_driver_stats_t stats;
+} mcmc_driver_t;
+
+void mcmc_driver_init(mcmc_driver_t *drv, const mcmc_driver_ops_t *ops, void *cookie,
+                      uint32_t free_epoch, bool count_failures);
+
+/**
+ * Run 'iterations' iterations from scratch, the figures of the run are
+ * left in 'drv->stats'. A failed request ends the run, unless failures
+ * are counted, and leaves its units outstanding.
+ *
+ * @return 0, or the error of the request which ended the run.
+ */
+int mcmc_driver_run(mcmc_driver_t *drv, uint32_t iterations);
+
+/* Units that still hold their blocks, queued ones included */
+static inline size_t mcmc_driver_outstanding(const mcmc_driver_t *drv)
+{
+    return drv->wheel.pending + drv->deferred_count;
+}
+
+/**
+ * Take every outstanding unit, queued ones included, off the driver, for
+ * the caller to free them after a run.
+ *
+ * @return a NULL-terminated list of their wheel nodes (linked by 'next').
+ */
+mcmc_wheel_node_t *mcmc_driver_drain(mcmc_driver_t *drv);
@@ -0,0 +1,39 @@
+/***
+ * Copyright 2023, zhuguangtao@iie.ac.cn, SKLOIS
+ *
+ * Log-bucketed latency histograms for MR-MC.
+ *
+ * Every power of two is split into MCMC_HIST_SUB_BUCKETS linear buckets, so
+ * any recorded value is reported with a relative error of at most 1/8, while
+ * the whole 64-bit range fits into a fixed and small number of counters.
+ */
+#pragma once
+
+#include <stdint.h>
+
+#define MCMC_HIST_SUB_BITS      3
+#define MCMC_HIST_SUB_BUCKETS   (1u << MCMC_HIST_SUB_BITS)
+#define MCMC_HIST_BUCKETS       (MCMC_HIST_SUB_BUCKETS * (64 - MCMC_HIST_SUB_BITS + 1))
+
+typedef struct mcmc_hist {
+    uint64_t count;
+    uint64_t sum;
+    uint64_t min;
+    uint64_t max;
+    uint32_t buckets[MCMC_HIST_BUCKETS];
+} mcmc_hist_t;
+
+void mcmc_hist_init(mcmc_hist_t *hist);
+
+void mcmc_hist_record(mcmc_hist_t *hist, uint64_t value);
+
+/* Add all the samples of 'other' to 'hist' */
+void mcmc_hist_merge(mcmc_hist_t *hist, const mcmc_hist_t *other);
+
+/**
+ * Upper bound of the bucket holding the sample of rank ceil(count * num / den),
+ * e.g. (999, 1000) for p99.9. The result never exceeds the recorded maximum.
+ *
+ * @return 0 for an empty histogram.
+ */
+uint64_t mcmc_hist_quantile(const mcmc_hist_t *hist, uint64_t num, uint64_t den);
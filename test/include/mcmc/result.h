@@ -0,0 +1,38 @@
+/***
+ * Copyright 2023, zhuguangtao@iie.ac.cn, SKLOIS
+ *
+ * Binary result stream of MR-MC.
+ *
+ * Results are encoded as length-delimited nanopb Records (proto/mrmc.proto)
+ * into a buffer reserved before the run, and only written to the serial
+ * console by mcmc_result_flush once the measurement is over.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <mrmc.pb.h>
+
+/**
+ * Use 'size' bytes at 'buffer' for the records of this run.
+ */
+void mcmc_result_init(void *buffer, size_t size);
+
+/**
+ * Encode 'record' at the end of the buffer.
+ *
+ * @return false if the buffer is full, the record is dropped then.
+ */
+bool mcmc_result_append(const mrmc_Record *record);
+
+/**
+ * Dump all records encoded so far over the console and empty the buffer,
+ * see tools/mrmc-decode.py for the framing.
+ */
+void mcmc_result_flush(void);
+
+/**
+ * Dump 'size' bytes as hex lines "[tag] ..." between "[tag-BEGIN] count"
+ * and "[tag-END]" markers.
+ */
+void mcmc_hex_dump(const char *tag, const void *data, size_t size, size_t count);
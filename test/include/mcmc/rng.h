@@ -0,0 +1,50 @@
+/***
+ * Copyright 2023, zhuguangtao@iie.ac.cn, SKLOIS
+ *
+ * Seedable random streams for MR-MC memory requests.
+ *
+ * A stream is a 64-bit counter advanced by a fixed odd increment, and every
+ * output is the counter run through the SplitMix64 finaliser. Streams hold
+ * no shared state, so every worker draws from its own stream without any
+ * locking, and (seed, stream) alone reproduces the very same requests.
+ */
+#pragma once
+
+#include <stdint.h>
+
+#define MCMC_RNG_INCREMENT 0x9e3779b97f4a7c15ull
+
+typedef struct mcmc_rng {
+    uint64_t counter;
+} mcmc_rng_t;
+
+static inline uint64_t mcmc_rng_mix(uint64_t z)
+{
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+/**
+ * Start stream 'stream' of 'seed'. Streams start at scrambled counters, and
+ * the draws of one run are far too few for two of them to ever overlap.
+ */
+static inline void mcmc_rng_seed(mcmc_rng_t *rng, uint64_t seed, uint64_t stream)
+{
+    rng->counter = mcmc_rng_mix(seed ^ mcmc_rng_mix(stream + MCMC_RNG_INCREMENT));
+}
+
+static inline uint64_t mcmc_rng_next(mcmc_rng_t *rng)
+{
+    rng->counter += MCMC_RNG_INCREMENT;
+    return mcmc_rng_mix(rng->counter);
+}
+
+/**
+ * Draw from [0, bound) by multiply-shift of the upper 32 bits, without any
+ * rejection loop (the bias is below bound / 2^32).
+ */
+static inline uint32_t mcmc_rng_below(mcmc_rng_t *rng, uint32_t bound)
+{
+    return (uint32_t)(((mcmc_rng_next(rng) >> 32) * bound) >> 32);
+}
@@ -0,0 +1,64 @@
+/***
+ * Copyright 2023, zhuguangtao@iie.ac.cn, SKLOIS
+ *
+ * Time-series sampling of the MR-MC memory footprint.
+ *
+ * Every 'interval' iterations the driver stores one sample into a ring
+ * buffer reserved before the run. Nothing is reported while sampling, and
+ * once the ring is full the oldest samples are overwritten.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* largest_order of a sample taken without probing the allocator */
+#define MCMC_SAMPLE_NO_PROBE    (-2)
+/* largest_order of a sample when not even a single frame is allocatable */
+#define MCMC_SAMPLE_EXHAUSTED   (-1)
+/* metadata_bytes of a sample taken without MRMCMetadataReport */
+#define MCMC_SAMPLE_NO_METADATA UINT64_MAX
+
+typedef struct mcmc_sample {
+    uint32_t iteration;
+    uint32_t live_units;
+    /* frames held by the blocks of the outstanding units */
+    uint64_t live_frames;
+    /* largest allocatable block order, every lower order is allocatable too */
+    int32_t largest_order;
+    /* bytes of allocman metadata in use */
+    uint64_t metadata_bytes;
+} mcmc_sample_t;
+
+typedef struct mcmc_sampler {
+    mcmc_sample_t *ring;
+    size_t capacity;
+    /* number of samples ever taken */
+    size_t taken;
+    uint32_t interval;
+} mcmc_sampler_t;
+
+/**
+ * Use 'capacity' samples at 'ring' to sample every 'interval' iterations,
+ * an interval of 0 disables sampling.
+ */
+void mcmc_sampler_init(mcmc_sampler_t *sampler, mcmc_sample_t *ring, size_t capacity, uint32_t interval);
+
+static inline bool mcmc_sampler_due(const mcmc_sampler_t *sampler, uint32_t iteration)
+{
+    return sampler->interval && iteration % sampler->interval == 0;
+}
+
+/**
+ * @return the slot for the next sample, overwriting the oldest one if full.
+ */
+mcmc_sample_t *mcmc_sampler_next(mcmc_sampler_t *sampler);
+
+/* Number of samples held by the ring */
+size_t mcmc_sampler_count(const mcmc_sampler_t *sampler);
+
+/**
+ * @return the i-th oldest sample held by the ring.
+ */
+const mcmc_sample_t *mcmc_sampler_get(const mcmc_sampler_t *sampler, size_t i);
@@ -0,0 +1,120 @@
+/***
+ * Copyright 2023, zhuguangtao@iie.ac.cn, SKLOIS
+ *
+ * Protocol between the memory server (the rootserver, with MRMCMemoryServer)
+ * and its client processes.
+ *
+ * A client draws the same random requests as a worker of the in-process run
+ * does, and sends them to the server in batches of up to MRMCServerBatch
+ * requests per message, one packed word per request, which the server
+ * answers word for word with the seL4_Error of every request. Memory units
+ * are named by handles the client picks itself, so as a batch may free a
+ * unit allocated earlier in the very same batch, and the server hands the
+ * frames of every unit over into the cslots of its handle in the cspace of
+ * the client (see mcmc_server_grant): all of them with MRMCServerGrantAll,
+ * else only the first one.
+ */
+#pragma once
+
+#include <stdint.h>
+
+/* Image of the clients in the CPIO archive of the rootserver */
+#define MCMC_CLIENT_IMAGE "sel4testcase-mce-client"
+
+/* Most units a client may have outstanding, and so the largest free frequency of its run */
+#define MCMC_CLIENT_MAX_HANDLES 4096
+
+/* Labels of the messages of a client */
+enum {
+    /* a batch of requests, answered with their errors */
+    MCMC_SERVER_BATCH = 1,
+    /* the run is over, the message holds an mcmc_client_stats_t, never answered */
+    MCMC_SERVER_DONE,
+};
+
+/***
+ * Requests: frames - 1 in the low MCMC_SERVER_FRAME_BITS bits, the handle
+ * above them, and the top bit set for frees (which carry no frames).
+ */
+#define MCMC_SERVER_FRAME_BITS 10
+#define MCMC_SERVER_FREE       (1u << 31)
+
+static inline uint32_t mcmc_server_alloc_op(uint32_t handle, uint32_t frames)
+{
+    return (handle << MCMC_SERVER_FRAME_BITS) | (frames - 1);
+}
+
+static inline uint32_t mcmc_server_free_op(uint32_t handle)
+{
+    return MCMC_SERVER_FREE | (handle << MCMC_SERVER_FRAME_BITS);
+}
+
+static inline uint32_t mcmc_server_op_handle(uint32_t op)
+{
+    return (op & ~MCMC_SERVER_FREE) >> MCMC_SERVER_FRAME_BITS;
+}
+
+static inline uint32_t mcmc_server_op_frames(uint32_t op)
+{
+    return (op & ((1u << MCMC_SERVER_FRAME_BITS) - 1)) + 1;
+}
+
+/* Cslots of a client per handle, one for every frame a unit may have with MRMCServerGrantAll */
+#ifdef CONFIG_MRMC_SERVER_GRANT_ALL
+#define MCMC_CLIENT_HANDLE_SLOTS (1u << MCMC_SERVER_FRAME_BITS)
+#else
+#define MCMC_CLIENT_HANDLE_SLOTS 1u
+#endif
+
+/* Cslot (past the one of frame 0 of handle 0) that frame 'frame' of 'handle' is granted into */
+static inline uint32_t mcmc_client_frame_slot(uint32_t handle, uint32_t frame)
+{
+    return handle * MCMC_CLIENT_HANDLE_SLOTS + frame;
+}
+
+/* Arguments of a client, as decimal strings in argv */
+enum {
+    /* index of the client, and the stream of its requests */
+    MCMC_CLIENT_ARG_INDEX,
+    /* cslot of the badged endpoint of the server */
+    MCMC_CLIENT_ARG_ENDPOINT,
+    /* cslot that frame 0 of handle 0 is granted into, see mcmc_client_frame_slot */
+    MCMC_CLIENT_ARG_SLOTS,
+    MCMC_CLIENT_ARG_ITERATIONS,
+    MCMC_CLIENT_ARG_FREE_FREQUENCY,
+    MCMC_CLIENT_ARG_POLICY,
+    MCMC_CLIENT_ARG_SEED,
+    /* most requests per message */
+    MCMC_CLIENT_ARG_BATCH,
+    MCMC_CLIENT_ARGS
+};
+
+/**
+ * What a client saw of its run, sent in the message registers of
+ * MCMC_SERVER_DONE. Every message is timed once, from its seL4_Call to the
+ * reply: the latency of a batch is that round trip, IPC included, and the
+ * latency of a request the round trip shared out over the requests of the
+ * message.
+ */
+typedef struct mcmc_client_stats {
+    uint64_t iterations;
+    /* allocations granted and frees done */
+    uint64_t requests;
+    uint64_t frees;
+    uint64_t total_frames;
+    /* seL4_NoError, or the error of the allocation which ended the run */
+    int64_t error;
+    /* messages sent, and the cycles of all of their round trips */
+    uint64_t batches;
+    uint64_t round_trip_sum;
+    /* one sample per message: its round trip */
+    uint64_t batch_p50;
+    uint64_t batch_p99;
+    uint64_t batch_max;
+    /* one sample per message: its round trip over the requests it carried */
+    uint64_t request_p50;
+    uint64_t request_p99;
+    uint64_t request_max;
+    /* from the first request to the reply to the last one */
+    uint64_t cycles;
+} mcmc_client_stats_t;
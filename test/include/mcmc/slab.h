@@ -0,0 +1,43 @@
+/***
+ * Copyright 2023, zhuguangtao@iie.ac.cn, SKLOIS
+ *
+ * Fixed-size slab arenas for MR-MC bookkeeping objects.
+ *
+ * The backing memory of an arena is reserved once, before the timed region,
+ * and objects are handed out from an intrusive free list afterwards, so as
+ * the bookkeeping of the simulation never goes through the muslc heap while
+ * the allocators are being measured.
+ */
+#pragma once
+
+#include <stddef.h>
+
+typedef struct mcmc_slab {
+    /* size of one object, rounded up to keep objects pointer aligned */
+    size_t obj_size;
+    size_t capacity;
+    size_t in_use;
+    /* largest number of objects which were in use at the same time */
+    size_t high_water;
+    /* free objects, linked through their first word */
+    void *free_list;
+} mcmc_slab_t;
+
+/**
+ * Bytes of backing memory needed by an arena of 'capacity' objects
+ * of 'obj_size' bytes each.
+ */
+size_t mcmc_slab_bytes(size_t obj_size, size_t capacity);
+
+/**
+ * Carve 'mem' (at least mcmc_slab_bytes(obj_size, capacity) bytes) into
+ * 'capacity' free objects.
+ */
+void mcmc_slab_init(mcmc_slab_t *slab, void *mem, size_t obj_size, size_t capacity);
+
+/**
+ * @return one zeroed object, or NULL if the arena is exhausted.
+ */
+void *mcmc_slab_alloc(mcmc_slab_t *slab);
+
+void mcmc_slab_free(mcmc_slab_t *slab, void *obj);
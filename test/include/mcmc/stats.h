@@ -0,0 +1,41 @@
+/***
+ * Copyright 2023, zhuguangtao@iie.ac.cn, SKLOIS
+ *
+ * Running estimators over independent replicas of an MR-MC run.
+ *
+ * Every replica contributes one (integer, suitably scaled) value, and only
+ * the count, sum and sum of squares are kept, so the mean and a Student's t
+ * confidence interval of it are available after every replica. Everything
+ * is kept in 64 bits, which holds as long as the number of values times the
+ * largest of them stays below 2^32.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct mcmc_stat {
+    uint64_t count;
+    uint64_t sum;
+    uint64_t sum_sq;
+} mcmc_stat_t;
+
+void mcmc_stat_init(mcmc_stat_t *stat);
+
+void mcmc_stat_add(mcmc_stat_t *stat, uint64_t value);
+
+/* @return the mean of the values added so far, 0 if there are none */
+uint64_t mcmc_stat_mean(const mcmc_stat_t *stat);
+
+/**
+ * Half width of the 95% confidence interval of the mean.
+ *
+ * @return UINT64_MAX with fewer than two values.
+ */
+uint64_t mcmc_stat_ci95(const mcmc_stat_t *stat);
+
+/**
+ * @return true once the half width of the 95% confidence interval is at most
+ * 'tolerance' thousandths of the mean.
+ */
+bool mcmc_stat_converged(const mcmc_stat_t *stat, uint32_t tolerance);
@@ -0,0 +1,55 @@
+/***
+ * Copyright 2023, zhuguangtao@iie.ac.cn, SKLOIS
+ *
+ * Parameter grids for MR-MC sweeps.
+ *
+ * A sweep is the cartesian product of a few axes (size policy, free
+ * frequency, iterations and seed), each given as a comma separated list.
+ * Points are numbered in row-major order with the seed varying fastest, so
+ * the replicas of one configuration are always run back to back.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define MCMC_SWEEP_MAX_VALUES 16
+
+enum {
+    MCMC_SWEEP_POLICY,
+    MCMC_SWEEP_FREE_FREQUENCY,
+    MCMC_SWEEP_ITERATIONS,
+    MCMC_SWEEP_SEED,
+    MCMC_SWEEP_AXES
+};
+
+typedef struct mcmc_sweep {
+    size_t counts[MCMC_SWEEP_AXES];
+    uint32_t values[MCMC_SWEEP_AXES][MCMC_SWEEP_MAX_VALUES];
+} mcmc_sweep_t;
+
+typedef struct mcmc_sweep_point {
+    uint32_t policy;
+    uint32_t free_frequency;
+    uint32_t iterations;
+    uint32_t seed;
+} mcmc_sweep_point_t;
+
+/**
+ * Set the values of 'axis' from a "v,v,..." list. With 'names', every value
+ * is one of the 'name_count' names and stands for its index, else it is a
+ * number in [min_value, UINT32_MAX].
+ *
+ * @return 0 on success, -1 on an empty, overlong or malformed list.
+ */
+int mcmc_sweep_parse(mcmc_sweep_t *sweep, int axis, const char *spec,
+                     const char *const *names, size_t name_count, uint32_t min_value);
+
+/* Number of points of the grid */
+size_t mcmc_sweep_points(const mcmc_sweep_t *sweep);
+
+/* Largest value of 'axis' */
+uint32_t mcmc_sweep_max(const mcmc_sweep_t *sweep, int axis);
+
+/* The 'index'-th point of the grid */
+void mcmc_sweep_point(const mcmc_sweep_t *sweep, size_t index, mcmc_sweep_point_t *point);
@@ -0,0 +1,51 @@
+/***
+ * Copyright 2023, zhuguangtao@iie.ac.cn, SKLOIS
+ *
+ * Binary alloc/free traces for MR-MC record and replay.
+ *
+ * A trace is a header followed by fixed-size records, all fields little
+ * endian 32-bit words, so as it can be used in place (e.g. straight out of
+ * the CPIO archive of the image) without parsing every record. Records are
+ * sorted by iteration, several records may share one iteration, and every
+ * record is freed at its expiry iteration. See tools/mrmc-trace.py.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* "MRMC" */
+#define MCMC_TRACE_MAGIC    0x434d524du
+#define MCMC_TRACE_VERSION  1
+/* Name of the trace inside the CPIO archive of the image */
+#define MCMC_TRACE_CPIO_NAME "mrmc.trace"
+
+typedef struct mcmc_trace_header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t records;
+    /* iteration of the last record */
+    uint32_t iterations;
+    /* peak number of outstanding units and frames, for sizing arenas */
+    uint32_t max_live_units;
+    uint32_t max_live_frames;
+} mcmc_trace_header_t;
+
+typedef struct mcmc_trace_record {
+    uint32_t iteration;
+    uint32_t expiry;
+    uint32_t frames;
+} mcmc_trace_record_t;
+
+/**
+ * Check the header, the size and the record order of a trace of 'size'
+ * bytes at 'data', with at most 'max_frames' frames per record.
+ *
+ * @return the header (records follow right after it), or NULL if invalid.
+ */
+const mcmc_trace_header_t *mcmc_trace_check(const void *data, size_t size, uint32_t max_frames);
+
+static inline const mcmc_trace_record_t *mcmc_trace_records(const mcmc_trace_header_t *header)
+{
+    return (const mcmc_trace_record_t *)(header + 1);
+}
@@ -0,0 +1,59 @@
+/***
+ * Copyright 2023, zhuguangtao@iie.ac.cn, SKLOIS
+ *
+ * Hierarchical timing wheel for MR-MC memory unit expiry.
+ *
+ * Memory units are bucketed by the iteration at which they expire, so the
+ * simulation only touches the units that expire at the current iteration
+ * instead of scanning every outstanding unit. Level 0 resolves single
+ * iterations, every upper level covers MCMC_WHEEL_LEVEL_SLOTS times the range
+ * of the level below it, and expiries beyond the top level wait on an overflow
+ * list that is only revisited once per full turn of the wheel.
+ */
+#pragma once
+
+#include <stddef.h>
+
+#define MCMC_WHEEL_LEVEL_BITS   6
+#define MCMC_WHEEL_LEVEL_SLOTS  (1ul << MCMC_WHEEL_LEVEL_BITS)
+#define MCMC_WHEEL_LEVEL_MASK   (MCMC_WHEEL_LEVEL_SLOTS - 1)
+#define MCMC_WHEEL_LEVELS       4
+
+/**
+ * Intrusive wheel linkage, embed it as the first member of the object
+ * that should expire so as the node can be cast back to the object.
+ */
+typedef struct mcmc_wheel_node {
+    /* iteration at which this node expires */
+    size_t expiry;
+    struct mcmc_wheel_node *next;
+} mcmc_wheel_node_t;
+
+typedef struct mcmc_wheel {
+    /* current iteration of the wheel */
+    size_t now;
+    /* number of nodes which have not expired yet */
+    size_t pending;
+    mcmc_wheel_node_t *slots[MCMC_WHEEL_LEVELS][MCMC_WHEEL_LEVEL_SLOTS];
+    /* nodes which expire beyond the range of the top level */
+    mcmc_wheel_node_t *overflow;
+} mcmc_wheel_t;
+
+/**
+ * Reset the wheel to be empty at iteration 'now'.
+ */
+void mcmc_wheel_init(mcmc_wheel_t *wheel, size_t now);
+
+/**
+ * Schedule 'node' to expire at 'node->expiry', which must be later than
+ * the current iteration of the wheel.
+ */
+void mcmc_wheel_insert(mcmc_wheel_t *wheel, mcmc_wheel_node_t *node);
+
+/**
+ * Move the wheel forward by one iteration and detach the nodes which
+ * expire at the new iteration.
+ *
+ * @return a NULL-terminated list of expired nodes (linked by 'next').
+ */
+mcmc_wheel_node_t *mcmc_wheel_advance(mcmc_wheel_t *wheel);
@@ -0,0 +1,183 @@
+/***
+ * Copyright 2023, zhuguangtao@iie.ac.cn, SKLOIS
+ *
+ * Random memory request workload of MR-MC.
+ *
+ * Every iteration asks for one memory unit, whose size is drawn from the
+ * size distribution of a policy and whose lifetime is uniform in
+ * [1, free_frequency - 1] iterations. Shared by the rootserver and the host
+ * build (host/), so as one (seed, stream) yields the very same requests on
+ * both of them.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <mcmc/dist.h>
+#include <mcmc/rng.h>
+#include <mcmc/trace.h>
+
+/* Largest number of frames a single memory request may ask for */
+#define MCMC_MAX_FRAME_COUNT 1024
+#define MCMC_MAX_ORDER       10
+
+/* Seed of the request streams, worker 'n' draws from stream 'n' */
+#define MCMC_RNG_SEED 0x4d524d43ull
+
+/***
+ * Size policies of memory requests (frames per request):
+ *  - uniform-pow2: 2^0 .. 2^10 frames, equally likely (the default)
+ *  - uniform:      1 .. 1023 frames, equally likely
+ *  - inverse-pow2: 2^k frames with probability 2^-(k+1) (2^10 as likely as 2^9)
+ *  - table:        "frames:weight,frames:weight,..." given by the caller
+ */
+enum {
+    MCMC_POLICY_UNIFORM_POW2,
+    MCMC_POLICY_UNIFORM,
+    MCMC_POLICY_INVERSE_POW2,
+    MCMC_POLICY_TABLE,
+    MCMC_POLICIES
+};
+
+extern const char *const mcmc_policy_names[MCMC_POLICIES];
+
+/***
+ * Kinds of requests of MRMCObjectMix: a memory unit of the size policy
+ * (frames, through vka_alloc_frame_contiguous with CapBuddy), or a single
+ * kernel object of another kind. CNodes take a radix drawn uniformly from
+ * [MCMC_CNODE_MIN_RADIX, MCMC_CNODE_MAX_RADIX].
+ */
+enum {
+    MCMC_OBJECT_FRAMES,
+    MCMC_OBJECT_TCB,
+    MCMC_OBJECT_ENDPOINT,
+    MCMC_OBJECT_NOTIFICATION,
+    MCMC_OBJECT_CNODE,
+    MCMC_OBJECT_PAGE_TABLE,
+    MCMC_OBJECT_LARGE_PAGE,
+    MCMC_OBJECTS
+};
+
+#define MCMC_CNODE_MIN_RADIX 4
+#define MCMC_CNODE_MAX_RADIX 12
+
+extern const char *const mcmc_object_names[MCMC_OBJECTS];
+
+/***
+ * Kinds drawn before a run (MRMCObjectMix), one byte per request: the kind
+ * in the low MCMC_OBJECT_KIND_BITS bits, and the radix of a CNode, less
+ * MCMC_CNODE_MIN_RADIX, above them.
+ */
+typedef uint8_t mcmc_object_t;
+
+#define MCMC_OBJECT_KIND_BITS 3
+
+static inline mcmc_object_t mcmc_object_pack(int kind, uint32_t radix)
+{
+    uint32_t radix_bits = kind == MCMC_OBJECT_CNODE ? radix - MCMC_CNODE_MIN_RADIX : 0;
+
+    return kind | (radix_bits << MCMC_OBJECT_KIND_BITS);
+}
+
+static inline int mcmc_object_kind(mcmc_object_t object)
+{
+    return object & ((1u << MCMC_OBJECT_KIND_BITS) - 1);
+}
+
+static inline uint32_t mcmc_object_radix(mcmc_object_t object)
+{
+    return MCMC_CNODE_MIN_RADIX + (object >> MCMC_OBJECT_KIND_BITS);
+}
+
+/* Order of the smallest power-of-two block which holds 'frame_count' frames */
+static inline int mcmc_frame_order(uint32_t frame_count)
+{
+    return frame_count > 1 ? 32 - __builtin_clz(frame_count - 1) : 0;
+}
+
+/**
+ * Build the size distribution of 'policy' into 'dist', 'table' is the
+ * specification of MCMC_POLICY_TABLE (NULL if there is none).
+ *
+ * @return 0 on success, -1 on an unknown policy or an invalid table.
+ */
+int mcmc_workload_policy(mcmc_dist_t *dist, int policy, const char *table);
+
+/***
+ * Pre-drawn schedules (MRMCSchedule): the random requests of a whole run,
+ * drawn before it starts, one packed word per iteration: frames - 1 in the
+ * low MCMC_SCHEDULE_FRAME_BITS bits, the mcmc_object_t of the request
+ * (0 without an object mix) in the MCMC_SCHEDULE_OBJECT_BITS bits above
+ * them, and the lifetime (expiry - iteration) on top. Entry 'i - 1' holds
+ * the request of iteration 'i'.
+ */
+typedef uint32_t mcmc_schedule_t;
+
+#define MCMC_SCHEDULE_FRAME_BITS     10
+#define MCMC_SCHEDULE_OBJECT_BITS    7
+#define MCMC_SCHEDULE_LIFETIME_SHIFT (MCMC_SCHEDULE_FRAME_BITS + MCMC_SCHEDULE_OBJECT_BITS)
+#define MCMC_SCHEDULE_MAX_LIFETIME   ((1u << (32 - MCMC_SCHEDULE_LIFETIME_SHIFT)) - 1)
+
+static inline void mcmc_schedule_unpack(mcmc_schedule_t entry, uint32_t i, mcmc_trace_record_t *req)
+{
+    req->iteration = i;
+    req->expiry = i + (entry >> MCMC_SCHEDULE_LIFETIME_SHIFT);
+    req->frames = (entry & ((1u << MCMC_SCHEDULE_FRAME_BITS) - 1)) + 1;
+}
+
+static inline mcmc_object_t mcmc_schedule_object(mcmc_schedule_t entry)
+{
+    return (entry >> MCMC_SCHEDULE_FRAME_BITS) & ((1u << MCMC_SCHEDULE_OBJECT_BITS) - 1);
+}
+
+/**
+ * Draw the requests of iterations 1 .. 'iterations' into 'schedule', just
+ * as mcmc_workload_draw would draw them one by one from 'rng'. With a
+ * 'mix' (else NULL), their kinds come first, just as mcmc_workload_objects
+ * would draw them.
+ *
+ * @return 0 on success, -1 if lifetimes of 'free_frequency' do not fit.
+ */
+int mcmc_workload_schedule(mcmc_rng_t *rng, const mcmc_dist_t *dist, const mcmc_dist_t *mix,
+                           uint32_t free_frequency, mcmc_schedule_t *schedule, uint32_t iterations);
+
+/**
+ * Build the kind distribution of a "kind:weight,kind:weight,..." mix into
+ * 'dist', kinds by their name in mcmc_object_names, a missing ":weight"
+ * counts as weight 1.
+ *
+ * @return 0 on success, -1 on an unknown kind or a malformed mix.
+ */
+int mcmc_workload_object_mix(mcmc_dist_t *dist, const char *spec);
+
+/**
+ * Draw the request of iteration 'i' into 'req': its expiry first, then its
+ * size, both from 'rng'.
+ */
+static inline void mcmc_workload_draw(mcmc_rng_t *rng, const mcmc_dist_t *dist, uint32_t free_frequency,
+                                      uint32_t i, mcmc_trace_record_t *req)
+{
+    req->iteration = i;
+    req->expiry = i + 1 + mcmc_rng_below(rng, free_frequency - 1);
+    req->frames = mcmc_dist_sample(dist, mcmc_rng_next(rng));
+}
+
+/**
+ * Draw the kind of a request from 'mix', and the radix of a CNode into
+ * 'radix'.
+ */
+static inline int mcmc_workload_draw_object(mcmc_rng_t *rng, const mcmc_dist_t *mix, uint32_t *radix)
+{
+    int kind = mcmc_dist_sample(mix, mcmc_rng_next(rng));
+
+    if (kind == MCMC_OBJECT_CNODE) {
+        *radix = MCMC_CNODE_MIN_RADIX + mcmc_rng_below(rng, MCMC_CNODE_MAX_RADIX - MCMC_CNODE_MIN_RADIX + 1);
+    }
+    return kind;
+}
+
+/**
+ * Draw the kinds of the requests of iterations 1 .. 'iterations' into
+ * 'objects', entry 'i - 1' for iteration 'i', one after the other with
+ * mcmc_workload_draw_object.
+ */
+void mcmc_workload_objects(mcmc_rng_t *rng, const mcmc_dist_t *mix, mcmc_object_t *objects, uint32_t iterations);
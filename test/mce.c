@@ -20,13 +20,17 @@
 #include <string.h>
 #include <assert.h>
 #include <stdlib.h>
+#include <stdbool.h>
 #include <limits.h>
+#include <inttypes.h>
 #include <sel4runtime.h>
 #include <allocman/bootstrap.h>
 #include <allocman/vka.h>
+#include <allocman/utspace/split.h>
 #include <sel4utils/vspace.h>
 #include <sel4utils/stack.h>
 #include <sel4utils/process.h>
+#include <sel4utils/thread.h>
 #include <sel4test/test.h>
 #include <simple/simple.h>
 #include <simple-default/simple-default.h>
@@ -35,7 +39,29 @@
 #include <vka/capops.h>
 #include <vspace/vspace.h>
 #include <sel4platsupport/platsupport.h>
+#include <sel4bench/sel4bench.h>
+#include <cpio/cpio.h>
 #include <sel4/benchmark_utilisation_types.h>
+#ifdef CONFIG_MRMC_KERNEL_ENTRIES
+#include <sel4/benchmark_track_types.h>
+#include <sel4/arch/invocation.h>
+#endif
+#ifdef CONFIG_MRMC_MEMORY_SERVER
+#include <sel4utils/api.h>
+#endif
+#include <mcmc/wheel.h>
+#include <mcmc/driver.h>
+#include <mcmc/slab.h>
+#include <mcmc/hist.h>
+#include <mcmc/dist.h>
+#include <mcmc/trace.h>
+#include <mcmc/result.h>
+#include <mcmc/sampler.h>
+#include <mcmc/rng.h>
+#include <mcmc/sweep.h>
+#include <mcmc/stats.h>
+#include <mcmc/workload.h>
+#include <mcmc/server.h>
 
 struct mrmc_env {
     /***
@@ -49,9 +75,25 @@ struct mrmc_env {
 };
 typedef struct mrmc_env *mrmc_env_t;
 
+/**
+ * Most bytes of allocator metadata that one outstanding frame may take,
+ * which is reached with units of a single frame each: the split nodes of
+ * its untyped block and of the buddy split off for it, the vka_object_t of
+ * the block and the cptr of its frame cap. Check with MRMCMetadataReport.
+ */
+#define MCMC_METADATA_BYTES_PER_FRAME \
+    (2 * sizeof(struct utspace_split_node) + sizeof(vka_object_t) + sizeof(seL4_CPtr))
+
 #define BRK_VIRTUAL_DEFAULT_SIZE    (1ul << (seL4_PageBits + 10))
 #define ALLOCATOR_VIRTUAL_POOL_SIZE (1ul << (seL4_PageBits + 10))
-#define ALLOCATOR_STATIC_POOL_SIZE  (1ul << (seL4_PageBits +  5))
+/**
+ * The static pool is all allocman has while bootstrapping, when it takes the
+ * metadata of every untyped of bootinfo, each of which costs what the block
+ * of an outstanding frame does. It is .bss, so it does not grow with the
+ * workload: allocman uses it up first, and the virtual pool covers the rest.
+ */
+#define ALLOCATOR_STATIC_POOL_SIZE  ((1ul << (seL4_PageBits + 5)) + \
+                                     CONFIG_MAX_NUM_BOOTINFO_UNTYPED_CAPS * MCMC_METADATA_BYTES_PER_FRAME)
 
 /* The global environment variable for libOS */
 static struct mrmc_env env;
@@ -75,6 +117,279 @@ extern void *muslc_brk_reservation_start;
      config_set(CONFIG_LIB_ALLOCMAN_ALLOW_POOL_OPERATIONS))
 #endif
 
+/* Frames of all the (non-device) untyped memory handed to the rootserver */
+static size_t mcmc_untyped_frames(void)
+{
+    size_t frames = 0;
+
+    for (int i = 0; i < simple_get_untyped_count(&env.simple); ++i)
+    {
+        size_t size_bits;
+        uintptr_t paddr;
+        bool device;
+
+        simple_get_nth_untyped(&env.simple, i, &size_bits, &paddr, &device);
+        if (!device && size_bits >= seL4_PageBits) {
+            frames += BIT(size_bits - seL4_PageBits);
+        }
+    }
+    return frames;
+}
+
+/**
+ * Most memory units (and frames held by them) outstanding at once, set by
+ * mcmc_workload_init from the workload parameters before init_env, for
+ * sizing the bookkeeping arenas and the metadata pool of allocman.
+ */
+static size_t mcmc_live_units;
+static size_t mcmc_live_frames;
+
+/* Metadata of every frame the workload may hold, see MCMC_METADATA_BYTES_PER_FRAME */
+static size_t mcmc_metadata_size(void)
+{
+    return ROUND_UP(mcmc_live_frames * MCMC_METADATA_BYTES_PER_FRAME, BIT(seL4_PageBits));
+}
+
+/**
+ * The virtual pool and the muslc heap only reserve address space, pages are
+ * mapped as they grow into it, so both are sized for the worst case: the
+ * metadata of every frame the workload may hold. allocman takes its own
+ * from the virtual pool, while the pool operations of CapBuddy go through
+ * malloc and so take theirs from the heap.
+ */
+static size_t mcmc_virtual_pool_size(void)
+{
+    return ALLOCATOR_VIRTUAL_POOL_SIZE + mcmc_metadata_size();
+}
+
+#if (CONFIG_LIB_SEL4_MUSLC_SYS_MORECORE_BYTES == 0)
+static size_t mcmc_brk_size(void)
+{
+    return BRK_VIRTUAL_DEFAULT_SIZE + mcmc_metadata_size();
+}
+#endif
+
+#ifdef CONFIG_MRMC_METADATA_REPORT
+/***
+ * Metadata accounting: allocman takes all of its own bookkeeping (cspace
+ * bitmaps, untyped split trees, CapBuddy pools, ...) from its mspace, so
+ * the mspace interface is wrapped to count the bytes it has handed out.
+ * What allocman took from the static pool while bootstrapping is not
+ * counted, it is all there before the first run anyway.
+ */
+static struct mspace_interface mcmc_metadata_mspace;
+static size_t mcmc_metadata_bytes;
+static size_t mcmc_metadata_peak;
+
+static void *mcmc_metadata_alloc(struct allocman *alloc, void *cookie, size_t bytes, int *error)
+{
+    void *ptr = mcmc_metadata_mspace.alloc(alloc, cookie, bytes, error);
+
+    if (ptr) {
+        mcmc_metadata_bytes += bytes;
+        mcmc_metadata_peak = MAX(mcmc_metadata_peak, mcmc_metadata_bytes);
+    }
+    return ptr;
+}
+
+static void mcmc_metadata_free(struct allocman *alloc, void *cookie, void *ptr, size_t bytes)
+{
+    mcmc_metadata_mspace.free(alloc, cookie, ptr, bytes);
+    mcmc_metadata_bytes -= bytes;
+}
+
+static void mcmc_metadata_attach(allocman_t *allocman)
+{
+    mcmc_metadata_mspace = allocman->mspace;
+    allocman->mspace.alloc = mcmc_metadata_alloc;
+    allocman->mspace.free = mcmc_metadata_free;
+}
+#endif
+
+#ifdef CONFIG_MRMC_KERNEL_ENTRIES
+/***
+ * Kernel entries: with KernelBenchmarks=track_kernel_entries, the kernel
+ * logs every entry (its path, syscall, invocation label and duration) into
+ * a large page handed to it by init_env. After every run the log is summed
+ * up by invocation label (object invocations), by syscall for messages
+ * to endpoints and notifications (ipc, including every fastpath entry),
+ * by syscall (any other syscall) and by path (interrupts and faults).
+ * The label of an IPC is only the message label, so it must not be taken
+ * for an invocation: a MemoryServer batch would count as Untyped_Retype
+ * otherwise. The kernel drops whatever
+ * does not fit into the log any more, so a run that fills it up is only
+ * accounted for up to that point.
+ */
+#ifdef seL4_LogBufferSize
+#define MCMC_KERNEL_LOG_SIZE seL4_LogBufferSize
+#else
+#define MCMC_KERNEL_LOG_SIZE BIT(seL4_LargePageBits)
+#endif
+#define MCMC_KERNEL_LOG_ENTRIES (MCMC_KERNEL_LOG_SIZE / sizeof(benchmark_track_kernel_entry_t))
+/* Ids (labels, syscalls, paths) of every kind, the last one takes all the larger ones */
+#define MCMC_KERNEL_ENTRY_IDS 128
+/* cap_tag_t of the caps a message goes through (the kernel's structures_*.bf) */
+#define MCMC_CAP_ENDPOINT 4
+#define MCMC_CAP_NOTIFICATION 6
+#define MCMC_CAP_REPLY 8
+
+enum {
+    MCMC_ENTRY_INVOCATION,
+    MCMC_ENTRY_IPC,
+    MCMC_ENTRY_SYSCALL,
+    MCMC_ENTRY_PATH,
+    MCMC_ENTRY_KINDS
+};
+
+static const char *const mcmc_entry_kinds[MCMC_ENTRY_KINDS] = {
+    "invocation", "ipc", "syscall", "path"
+};
+
+/* Indexed by entry_type_t */
+static const char *const mcmc_entry_paths[] = {
+    "interrupt", "unknown-syscall", "user-fault", "debug-fault",
+    "vm-fault", "syscall", "unimplemented-device", "vcpu-fault"
+};
+
+/* Invocations the allocators (and MRMCMapTouch) go through */
+static const struct {
+    int label;
+    const char *name;
+} mcmc_invocation_names[] = {
+    {UntypedRetype, "Untyped_Retype"},
+    {CNodeRevoke, "CNode_Revoke"},
+    {CNodeDelete, "CNode_Delete"},
+    {CNodeCopy, "CNode_Copy"},
+    {CNodeMint, "CNode_Mint"},
+    {CNodeMove, "CNode_Move"},
+#if defined(CONFIG_ARCH_ARM)
+    {ARMPageMap, "Page_Map"},
+    {ARMPageUnmap, "Page_Unmap"},
+    {ARMPageTableMap, "PageTable_Map"},
+#elif defined(CONFIG_ARCH_X86)
+    {X86PageMap, "Page_Map"},
+    {X86PageUnmap, "Page_Unmap"},
+    {X86PageTableMap, "PageTable_Map"},
+#elif defined(CONFIG_ARCH_RISCV)
+    {RISCVPageMap, "Page_Map"},
+    {RISCVPageUnmap, "Page_Unmap"},
+    {RISCVPageTableMap, "PageTable_Map"},
+#endif
+};
+
+typedef struct mcmc_entry_stats {
+    uint64_t count;
+    uint64_t cycles;
+    uint64_t max;
+} mcmc_entry_stats_t;
+
+static benchmark_track_kernel_entry_t *mcmc_kernel_log;
+static mcmc_entry_stats_t mcmc_entry_stats[MCMC_ENTRY_KINDS][MCMC_KERNEL_ENTRY_IDS];
+
+static void mcmc_kernel_log_init(mrmc_env_t env)
+{
+    vka_object_t frame;
+
+    int err = vka_alloc_frame(&env->vka, seL4_LargePageBits, &frame);
+    if (err) {
+        ZF_LOGF("Failed to allocate the kernel log buffer");
+    }
+    mcmc_kernel_log = vspace_map_pages(&env->vspace, &frame.cptr, NULL, seL4_AllRights, 1, seL4_LargePageBits, 1);
+    if (mcmc_kernel_log == NULL) {
+        ZF_LOGF("Failed to map the kernel log buffer");
+    }
+    err = seL4_BenchmarkSetLogBuffer(frame.cptr);
+    if (err) {
+        ZF_LOGF("Failed to set the kernel log buffer");
+    }
+}
+
+static const char *mcmc_entry_name(int kind, size_t id)
+{
+    if (kind == MCMC_ENTRY_PATH && id < ARRAY_SIZE(mcmc_entry_paths)) {
+        return mcmc_entry_paths[id];
+    }
+    if (kind == MCMC_ENTRY_INVOCATION) {
+        for (size_t n = 0; n < ARRAY_SIZE(mcmc_invocation_names); ++n)
+        {
+            if (mcmc_invocation_names[n].label == id) {
+                return mcmc_invocation_names[n].name;
+            }
+        }
+    }
+    return NULL;
+}
+
+/* Sum up the first 'entries' entries of the kernel log */
+static void mcmc_kernel_log_sum(size_t entries)
+{
+    memset(mcmc_entry_stats, 0, sizeof(mcmc_entry_stats));
+    for (size_t e = 0; e < entries; ++e)
+    {
+        const benchmark_track_kernel_entry_t *log = &mcmc_kernel_log[e];
+        int kind = MCMC_ENTRY_PATH;
+        size_t id = log->entry.path;
+
+        if (log->entry.path == Entry_Syscall) {
+            /* syscall_no is the negated syscall, object invocations go through Call, Send or NBSend */
+            int syscall = -(int)log->entry.syscall_no;
+            int cap_type = log->entry.cap_type;
+            bool ipc = log->entry.is_fastpath || cap_type == MCMC_CAP_ENDPOINT ||
+                       cap_type == MCMC_CAP_NOTIFICATION || cap_type == MCMC_CAP_REPLY;
+            if (ipc) {
+                kind = MCMC_ENTRY_IPC;
+                id = log->entry.syscall_no;
+            } else if (syscall == seL4_SysCall || syscall == seL4_SysSend || syscall == seL4_SysNBSend) {
+                kind = MCMC_ENTRY_INVOCATION;
+                id = log->entry.invocation_tag;
+            } else {
+                kind = MCMC_ENTRY_SYSCALL;
+                id = log->entry.syscall_no;
+            }
+        }
+        mcmc_entry_stats_t *stats = &mcmc_entry_stats[kind][MIN(id, MCMC_KERNEL_ENTRY_IDS - 1)];
+        stats->count++;
+        stats->cycles += log->duration;
+        stats->max = MAX(stats->max, log->duration);
+    }
+}
+
+static void mcmc_kernel_log_report(size_t entries)
+{
+    mrmc_Record record = mrmc_Record_init_zero;
+    mrmc_KernelEntry *entry = &record.payload.kernel_entry;
+
+    printf("[KERNEL]: %zu entries logged%s\n", entries,
+           entries >= MCMC_KERNEL_LOG_ENTRIES ? " (log full, later entries are missing)" : "");
+    record.which_payload = mrmc_Record_kernel_entry_tag;
+    for (int kind = 0; kind < MCMC_ENTRY_KINDS; ++kind)
+    {
+        for (size_t id = 0; id < MCMC_KERNEL_ENTRY_IDS; ++id)
+        {
+            const mcmc_entry_stats_t *stats = &mcmc_entry_stats[kind][id];
+            const char *name = mcmc_entry_name(kind, id);
+
+            if (stats->count == 0) {
+                continue;
+            }
+            printf("[KERNEL] %s %zu %s: count %" PRIu64 " cycles %" PRIu64 " max %" PRIu64 "\n",
+                   mcmc_entry_kinds[kind], id, name ? name : "-", stats->count, stats->cycles, stats->max);
+            memset(entry, 0, sizeof(*entry));
+            strncpy(entry->kind, mcmc_entry_kinds[kind], sizeof(entry->kind) - 1);
+            entry->id = id;
+            entry->has_name = name != NULL;
+            if (name) {
+                strncpy(entry->name, name, sizeof(entry->name) - 1);
+            }
+            entry->count = stats->count;
+            entry->cycles = stats->cycles;
+            entry->max = stats->max;
+            mcmc_result_append(&record);
+        }
+    }
+}
+#endif
+
 static void init_env(mrmc_env_t env)
 {
     /***
@@ -84,8 +399,19 @@ static void init_env(mrmc_env_t env)
      * At the very first, only static pool is provided because during bootstrap it's
      * forbidden for the thread to use virtual space to meet dynamic memory requests.
      */
+#ifdef CONFIG_MRMC_TWO_LEVEL_CSPACE
+    /***
+     * With MRMCTwoLevelCSpace, a new two-level cspace takes over from the root CNode,
+     * which goes into it as is, so as every cptr of bootinfo stays valid. Level-two
+     * CNodes are only allocated as cslots run out, so up to 2^(L1 + L2) of them.
+     */
+    allocman_t *allocman = bootstrap_new_2level_simple(&env->simple, CONFIG_MRMC_CSPACE_L1_BITS,
+                                                       CONFIG_MRMC_CSPACE_L2_BITS,
+                                                       ALLOCATOR_STATIC_POOL_SIZE, allocator_mem_pool);
+#else
     allocman_t *allocman = bootstrap_use_current_simple(&env->simple,
                                                         ALLOCATOR_STATIC_POOL_SIZE, allocator_mem_pool);
+#endif
     if (allocman == NULL) {
         ZF_LOGF("Failed to create allocman");
     }
@@ -115,7 +441,7 @@ static void init_env(mrmc_env_t env)
      * interfaces are available. (malloc/calloc/free)
      */
     err = sel4utils_reserve_range_no_alloc(&env->vspace, muslc_brk_reservation_memory,
-                                           BRK_VIRTUAL_DEFAULT_SIZE, seL4_AllRights, 1, &muslc_brk_reservation_start);
+                                           mcmc_brk_size(), seL4_AllRights, 1, &muslc_brk_reservation_start);
     if (err) {
         ZF_LOGE("Failed to reserve range for muslc heap initialization");
     }
@@ -131,8 +457,9 @@ static void init_env(mrmc_env_t env)
      * to apply memory requests for allocator metadata to help managing kernel objects' user-level
      * information.
      */
+    size_t virtual_pool_size = mcmc_virtual_pool_size();
     virtual_reservation = vspace_reserve_range(&env->vspace,
-                                               ALLOCATOR_VIRTUAL_POOL_SIZE, seL4_AllRights, 1, &vaddr);
+                                               virtual_pool_size, seL4_AllRights, 1, &vaddr);
     /***
      * We need to make sure that the regions for memory requests, which reside in virtual address space,
      * are successfully reserved by vspace manager, so as new pages can be mapped to activate these
@@ -143,107 +470,345 @@ static void init_env(mrmc_env_t env)
     }
     /* Now configure the virtual pool (by initializing new interfaces that will require memory dynamically) */
     bootstrap_configure_virtual_pool(allocman, vaddr,
-                                     ALLOCATOR_VIRTUAL_POOL_SIZE, simple_get_pd(&env->simple));
+                                     virtual_pool_size, simple_get_pd(&env->simple));
+#ifdef CONFIG_MRMC_METADATA_REPORT
+    mcmc_metadata_attach(allocman);
+#endif
+#ifdef CONFIG_MRMC_KERNEL_ENTRIES
+    mcmc_kernel_log_init(env);
+#endif
 }
 
+#define MCMC_ITERATION_TIME 80000
+#define MCMC_FREE_FREQUENCY 80
+
+/* MRMCSeed picks other request streams than the default ones, which the host build draws as well */
+#if CONFIG_MRMC_SEED
+#define MCMC_SEED ((uint64_t)CONFIG_MRMC_SEED)
+#else
+#define MCMC_SEED MCMC_RNG_SEED
+#endif
+
 /***
  * Random Sequences (based on different policies) of memory request
- * size (alloc/free size per iteration timestamp)
+ * size (alloc/free size per iteration timestamp), see mcmc/workload.h.
+ * The policy is chosen by MRMCSizePolicy at configure time (or by
+ * MRMCSweepPolicies) and turned into an alias table by
+ * mcmc_size_policy_init before the timed region.
  */
-int get_random_size_policy_1()
+#if defined(CONFIG_MRMC_SIZE_POLICY_TABLE)
+#define MCMC_SIZE_POLICY MCMC_POLICY_TABLE
+#elif defined(CONFIG_MRMC_SIZE_POLICY_UNIFORM)
+#define MCMC_SIZE_POLICY MCMC_POLICY_UNIFORM
+#elif defined(CONFIG_MRMC_SIZE_POLICY_INVERSE_POW2)
+#define MCMC_SIZE_POLICY MCMC_POLICY_INVERSE_POW2
+#else
+#define MCMC_SIZE_POLICY MCMC_POLICY_UNIFORM_POW2
+#endif
+
+static mcmc_dist_t mcmc_size_dist;
+
+#ifdef CONFIG_MRMC_OBJECT_MIX
+/* Kinds of the requests, see mcmc_object_request */
+static mcmc_dist_t mcmc_object_mix;
+#endif
+
+static void mcmc_size_policy_init(int policy)
 {
-    int a = random() % 1024;
-    while (a == 0)
-    {
-        a = random() % 1024;
+#ifdef CONFIG_MRMC_SIZE_TABLE
+    const char *table = CONFIG_MRMC_SIZE_TABLE;
+#else
+    const char *table = NULL;
+#endif
+
+    if (mcmc_workload_policy(&mcmc_size_dist, policy, table)) {
+        ZF_LOGF("Invalid memory request size distribution");
     }
-    return a;
+#ifdef CONFIG_MRMC_OBJECT_MIX
+    if (mcmc_workload_object_mix(&mcmc_object_mix, CONFIG_MRMC_OBJECT_MIX_TABLE)) {
+        ZF_LOGF("Invalid kernel object mix");
+    }
+#endif
 }
 
-int get_random_size_policy_2()
-{
-    int a[11] = {1, 2, 4, 8, 16, 32, 64, 128, 256, 512, 1024};
-    int b = random() % 11;
-    return a[b];
-}
+/**
+ * Parameters of one simulation run. Without MRMCSweep, there is a single
+ * run with MRMCSizePolicy and the defaults above.
+ */
+typedef struct mcmc_params {
+    int policy;
+    uint32_t free_frequency;
+    uint32_t iterations;
+    uint64_t seed;
+} mcmc_params_t;
 
-int get_random_size_policy_3()
+static mcmc_params_t mcmc_params = {
+    .policy = MCMC_SIZE_POLICY,
+    .free_frequency = MCMC_FREE_FREQUENCY,
+    .iterations = MCMC_ITERATION_TIME,
+    .seed = MCMC_SEED,
+};
+
+/**
+ * Units live for less than free_frequency iterations after the one they
+ * were allocated at, so there are never more than free_frequency units
+ * (and their frames) outstanding at the same time.
+ */
+#define MCMC_MAX_LIVE_UNITS(free_frequency)  (free_frequency)
+#define MCMC_MAX_LIVE_FRAMES(free_frequency) (MCMC_MAX_LIVE_UNITS(free_frequency) * MCMC_MAX_FRAME_COUNT)
+
+/* With MRMCSmpWorkers one worker per core, else only the initial thread */
+#ifdef CONFIG_MRMC_SMP_WORKERS
+#define MCMC_WORKERS CONFIG_MAX_NUM_NODES
+#else
+#define MCMC_WORKERS 1
+#endif
+
+/**
+ * Sweeps, capacity searches, replicas, scaling steps and calibrations run
+ * many times per boot, cleaning up after every run. With MRMCSmpWorkers,
+ * mcmc_workers_run releases all workers into every one of them.
+ */
+#if defined(CONFIG_MRMC_SWEEP) || defined(CONFIG_MRMC_CAPACITY_SEARCH) || defined(CONFIG_MRMC_REPLICAS) || \
+    defined(CONFIG_MRMC_SCALING) || defined(CONFIG_MRMC_CALIBRATE)
+#define MCMC_MULTI_RUN
+#endif
+
+/* Runs that carry on past failed allocations, counting them */
+#if defined(CONFIG_MRMC_CAPACITY_SEARCH) || defined(CONFIG_MRMC_REPLICAS) || defined(CONFIG_MRMC_SCALING)
+#define MCMC_COUNT_FAILURES
+#endif
+
+/* Runs that time every allocation and every free on its own, see mcmc_op_alloc_cycles */
+#if defined(CONFIG_MRMC_SCALING) || defined(CONFIG_MRMC_OBJECT_MIX) || defined(CONFIG_MRMC_MEMORY_SERVER)
+#define MCMC_OP_CYCLES
+#endif
+
+/* TCB utilisation, unless the kernel tracks its entries instead */
+#if defined(CONFIG_KERNEL_BENCHMARK) && !defined(CONFIG_MRMC_KERNEL_ENTRIES)
+#define MCMC_TRACK_UTILISATION
+#endif
+
+/* Runs that count the cycles they took themselves */
+#if defined(CONFIG_MRMC_REPLICAS) || defined(CONFIG_MRMC_CALIBRATE) || defined(CONFIG_MRMC_MEMORY_SERVER)
+#define MCMC_RUN_CYCLES
+#endif
+
+/* Runs whose probes of the largest allocatable order are taken off their cycles again, see mcmc_probe_order */
+#if (defined(CONFIG_MRMC_SAMPLE_PROBE) || defined(CONFIG_MRMC_FREE_EPOCH)) && \
+    (defined(MCMC_TRACK_UTILISATION) || defined(MCMC_RUN_CYCLES))
+#define MCMC_PROBE_CYCLES
+#endif
+
+/* Runs that read the cycle counter, which sel4bench_init sets up on the core it runs on */
+#if defined(CONFIG_MRMC_LATENCY_HISTOGRAM) || defined(CONFIG_MRMC_MAP_TOUCH) || defined(MCMC_RUN_CYCLES) || \
+    defined(MCMC_OP_CYCLES) || defined(MCMC_PROBE_CYCLES)
+#define MCMC_READS_CYCLES
+#endif
+
+#ifdef CONFIG_MRMC_OBJECT_MIX
+/* MRMCObjectMix: allocations (failed ones included) and frees of one kind of request */
+typedef struct mcmc_object_stats {
+    size_t allocs;
+    size_t frees;
+    uint64_t alloc_cycles;
+    uint64_t free_cycles;
+    uint64_t alloc_max;
+    uint64_t free_max;
+} mcmc_object_stats_t;
+#endif
+
+/**
+ * Outcome of one simulation run, only reported once the benchmark counters
+ * have been read, so as no console output happens inside the timed region.
+ */
+typedef struct mcmc_result {
+    int iterations;
+    size_t requests;
+    size_t total_frames;
+    int error;
+    /* see mcmc_magazine_pop and mcmc_magazine_push */
+    size_t magazine_hits;
+    size_t magazine_misses;
+    size_t magazine_drained;
+    /* most frames held by outstanding units, queued ones included, and their sum over all iterations */
+    size_t peak_footprint;
+    uint64_t footprint_sum;
+    /* most units outstanding at once, queued ones included */
+    size_t peak_units;
+    /* batches of queued units freed, and the most units of one of them, see MRMCFreeEpoch */
+    size_t epochs;
+    size_t max_epoch_units;
+    /* least and sum of the largest orders allocatable right after the batches, see mcmc_driver_epoch */
+    int epoch_order_min;
+    int64_t epoch_order_sum;
+    /* MRMCCapacitySearch, MRMCReplicas: failed requests, and the iteration of the first one */
+    size_t failures;
+    int first_failure;
+    /* MRMCMetadataReport: allocman metadata before the run, and its peak during it */
+    size_t metadata_start;
+    size_t metadata_peak;
+    /**
+     * MRMCMapTouch: pages mapped (large ones among them), cycles spent, paging
+     * structures allocated, and cycles spent turning blocks into large pages
+     * and back, see mcmc_memory_unit_map
+     */
+    size_t mapped_pages;
+    size_t mapped_large_pages;
+    uint64_t large_page_cycles;
+    uint64_t map_cycles;
+    uint64_t unmap_cycles;
+    size_t paging_objects;
+    /* MRMCKernelEntries: entries in the kernel log after the run */
+    size_t kernel_log_entries;
+    /* cycles of the probes of the run, and the ones of the kernel among them, see mcmc_probe_order */
+    uint64_t probe_cycles;
+    uint64_t probe_kernel_cycles;
+    /* MRMCReplicas, MRMCCalibrate, MRMCMemoryServer: cycles the run took */
+    uint64_t cycles;
+#ifdef CONFIG_MRMC_CALIBRATE
+    /* TCB and kernel cycles, if the kernel tracks utilisation */
+    uint64_t tcb_cycles;
+    uint64_t kernel_cycles;
+#ifdef CONFIG_MRMC_SMP_WORKERS
+    /* cycles the simulation of the worker took on its core, summed over all of them in the total */
+    uint64_t worker_cycles;
+#endif
+#endif
+    /* MRMCScaling, MRMCObjectMix, MRMCMemoryServer: cycles of all allocations (failed ones included) and of all frees, and the frees */
+    uint64_t alloc_cycles;
+    uint64_t free_cycles;
+    size_t frees;
+#ifdef CONFIG_MRMC_OBJECT_MIX
+    mcmc_object_stats_t objects[MCMC_OBJECTS];
+#endif
+#ifdef CONFIG_MRMC_MEMORY_SERVER
+    /* messages served, and the cycles of their round trips, as the clients saw them */
+    size_t batches;
+    uint64_t round_trip_cycles;
+#endif
+    /* runs of many per boot: everything was given back after the run, see mcmc_teardown */
+    bool clean;
+} mcmc_result_t;
+
+/**
+ * Everything one worker of the simulation owns. Only vka (and allocman
+ * behind it) is shared between the workers, see mcmc_vka_lock.
+ */
+typedef struct mcmc_ctx {
+    int core;
+    mcmc_rng_t rng;
+    /**
+     * Outstanding memory units, bucketed by the iteration at which they expire,
+     * so as every iteration only visits the units it has to free, and queued
+     * ones with MRMCFreeEpoch, see mcmc_exp_simulation.
+     */
+    mcmc_driver_t driver;
+    /**
+     * Slab arenas for the bookkeeping of memory units, their vka objects and
+     * (cascading allocator only) their frames, see mcmc_arena_init.
+     */
+    mcmc_slab_t unit_slab;
+    mcmc_slab_t object_slab;
+#if !(ENABLE_CAPBUDDY_EXTENSION)
+#ifdef CONFIG_MRMC_BULK_RETYPE
+    /* free CNodes for bulk retype, see mcmc_frame_cnode_init */
+    vka_object_t **frame_cnode_pool;
+    size_t frame_cnode_top;
+#else
+    mcmc_slab_t frame_slab;
+#endif
+#endif
+#ifdef CONFIG_MRMC_MAGAZINE
+    /* recently freed units of every order, oldest first, see mcmc_magazine_push */
+    struct mcmc_memory_unit *magazine[MCMC_MAX_ORDER + 1][CONFIG_MRMC_MAGAZINE_SIZE];
+    size_t magazine_top[MCMC_MAX_ORDER + 1];
+#endif
+#ifdef CONFIG_MRMC_LATENCY_HISTOGRAM
+    /* see MCMC_LATENCY_START */
+    mcmc_hist_t alloc_latency[MCMC_MAX_ORDER + 1];
+    mcmc_hist_t free_latency[MCMC_MAX_ORDER + 1];
+#endif
+#ifdef CONFIG_MRMC_MAP_TOUCH
+    /* caps of the pages of the unit being mapped, see mcmc_memory_unit_pages */
+    seL4_CPtr map_caps[MCMC_MAX_FRAME_COUNT];
+#endif
+#ifdef CONFIG_MRMC_SCHEDULE
+    /* requests of the run, drawn before it, see mcmc_schedule_draw */
+    mcmc_schedule_t *schedule;
+#endif
+#if defined(CONFIG_MRMC_OBJECT_MIX) && !defined(CONFIG_MRMC_SCHEDULE)
+    /* kinds of the requests of the run, drawn before it (into the schedule with MRMCSchedule), see mcmc_objects_draw */
+    mcmc_object_t *objects;
+#endif
+    /* next record of the replayed trace, or iteration of the last random request */
+    size_t cursor;
+    mcmc_result_t result;
+#ifdef CONFIG_MRMC_SMP_WORKERS
+    sel4utils_thread_t thread;
+    /* the worker waits on it between runs, see mcmc_workers_run */
+    vka_object_t wake_ntfn;
+#endif
+} mcmc_ctx_t;
+
+static mcmc_ctx_t mcmc_ctx[MCMC_WORKERS];
+
+#ifdef CONFIG_MRMC_SMP_WORKERS
+/**
+ * allocman is not thread-safe, so every alloc/free of a memory unit holds
+ * this lock. The time spent waiting for it is part of the latency of the
+ * operation, as that is exactly what contention costs.
+ */
+static int mcmc_vka_lock_word;
+
+static inline void mcmc_vka_lock(void)
 {
-    int a[11] = {1, 2, 4, 8, 16, 32, 64, 128, 256, 512, 1024};
-    int b = (random() % 1024) + 1;
-    if (b == 1)
-    {
-        return a[10];
-    }
-    else if (b == 2)
-    {
-        return a[9];
-    }
-    else if (2 < b && b <= 4)
-    {
-        return a[8];
-    }
-    else if (4 < b && b <= 8)
-    {
-        return a[7];
-    }
-    else if (8 < b && b <= 16)
-    {
-        return a[6];
-    }
-    else if (16 < b && b <= 32)
-    {
-        return a[5];
-    }
-    else if (32 < b && b <= 64)
-    {
-        return a[4];
-    }
-    else if (64 < b && b <= 128)
-    {
-        return a[3];
-    }
-    else if (128 < b && b <= 256)
-    {
-        return a[2];
-    }
-    else if (256 < b && b <= 512)
-    {
-        return a[1];
-    }
-    else if (512 < b && b <= 1024)
+    while (__atomic_exchange_n(&mcmc_vka_lock_word, 1, __ATOMIC_ACQUIRE))
     {
-        return a[0];
+        while (__atomic_load_n(&mcmc_vka_lock_word, __ATOMIC_RELAXED));
     }
 }
 
-/* Random Sequence of memory request timestamp */
-int get_random_time(int a)
+static inline void mcmc_vka_unlock(void)
 {
-    int b = random() % a;
-    while (b == 0)
-    {
-        b = random() % a;
-    }
-    return b;
+    __atomic_store_n(&mcmc_vka_lock_word, 0, __ATOMIC_RELEASE);
 }
+#else
+static inline void mcmc_vka_lock(void) {}
+static inline void mcmc_vka_unlock(void) {}
+#endif
 
-#define MCMC_ITERATION_TIME 80000
-#define MCMC_FREE_FREQUENCY 80
+#ifdef CONFIG_MRMC_MAP_TOUCH
+/* Frames of one large page, and the most large pages a single memory unit may take */
+#define MCMC_LARGE_PAGE_ORDER (seL4_LargePageBits - seL4_PageBits)
+#define MCMC_LARGE_PAGES_MAX  \
+    (MCMC_LARGE_PAGE_ORDER <= MCMC_MAX_ORDER ? BIT(MCMC_MAX_ORDER - MCMC_LARGE_PAGE_ORDER) : 1)
+
+/* Where a memory unit is mapped into the rootserver, see mcmc_memory_unit_map */
+typedef struct mcmc_mapping {
+    void *vaddr;
+    uint32_t pages;
+    uint32_t page_bits;
+} mcmc_mapping_t;
+#endif
 
 /**
  * Monte Carlo experiment simulation function:
  *  1. CapBuddy enable (on split-based allocator).
  *  2. cascading split-based buddy allocator only.
+ *
+ * Both of them share the same driver (mcmc_exp_simulation), and differ
+ * only in how one memory unit is allocated and freed.
  */
 #if (ENABLE_CAPBUDDY_EXTENSION)
 
 typedef struct mcmc_memory_unit {
     /**
-     * We use time_stamp to denote when this piece of memory unit
-     * is allocated in case that we can free it later on.
+     * Memory units are queued in the expiry wheel, and node.expiry is the
+     * time_stamp (iteration) at which this piece of memory unit should be
+     * freed. It must be the first member, see mcmc_memory_unit_of.
      */
-    size_t time_stamp;
+    mcmc_wheel_node_t node;
 
     size_t iter_stamp;
     /**
@@ -253,125 +818,240 @@ typedef struct mcmc_memory_unit {
      *   frame_number = (compressed_frames->size_bits / seL4_PageBits);
      */
     vka_object_t *compressed_frames;
-    /**
-     * All mcmc_memory_unit will have to construct a list.
-     */
-    struct mcmc_memory_unit *next;
+#ifdef CONFIG_MRMC_OBJECT_MIX
+    /* MCMC_OBJECT_FRAMES, or the kind of the kernel object in 'object' instead */
+    int kind;
+    vka_object_t object;
+#endif
+#ifdef CONFIG_MRMC_MAP_TOUCH
+    mcmc_mapping_t mapping;
+    /* caps of the large pages the block is mapped with (none for every other block), see mcmc_large_pages_make */
+    uint32_t large_page_count;
+    seL4_CPtr large_pages[MCMC_LARGE_PAGES_MAX];
+#endif
 
 } mcmc_memory_unit_t;
 
-static mcmc_memory_unit_t *mcmc_memory_unit_list_head;
-static mcmc_memory_unit_t *mcmc_memory_unit_list_curr;
+#define mcmc_memory_unit_order(unit) ((unit)->compressed_frames->size_bits - seL4_PageBits)
+#define mcmc_memory_unit_block(unit) ((unit)->compressed_frames)
 
-static int mcmc_exp_simulation()
+static int mcmc_memory_unit_alloc(mcmc_ctx_t *ctx, vka_t *vka, mcmc_memory_unit_t *unit, uint32_t frame_count)
 {
-    vka_t *vka = &env.vka;
-    seL4_Word frame_type = kobject_get_type(KOBJECT_FRAME, 12);
-    size_t memory_footprint = 0;
-    int mcmc_errno = seL4_NoError;
+    uint32_t frame_sanitizer;
+    int block_size = mcmc_frame_order(frame_count) + seL4_PageBits;
 
-    int i = 1;
-    size_t total = 0;
+    unit->compressed_frames = (vka_object_t *)mcmc_slab_alloc(&ctx->object_slab);
+    if (unit->compressed_frames == NULL) {
+        return seL4_NotEnoughMemory;
+    }
     /**
-     * ta: to-allocate;
-     * tf: to-free;
-     * time_stamp: a point within the MCMC time serie.
-     * frame_count: number of frames to alloc/free at this time.
-     */
-    uint32_t ta_frame_sanitizer, ta_frame_count;
-    int ta_time_stamp, ta_block_size;
+     * We should now allocate frames in here.
+     * by means of calling 'vka_alloc_frame_contiguous' can we benefit from
+     * allocating contiguous frames in bulk.
+    */
+    int err = vka_alloc_frame_contiguous(vka, block_size, &frame_sanitizer, unit->compressed_frames);
+    if (err) {
+        mcmc_slab_free(&ctx->object_slab, unit->compressed_frames);
+        return err;
+    }
+    /* Requests which are not a power of two still occupy a whole block */
+    assert(frame_sanitizer == BIT(block_size - seL4_PageBits));
+    return seL4_NoError;
+}
 
-    mcmc_memory_unit_list_head = (mcmc_memory_unit_t *)malloc(sizeof(mcmc_memory_unit_t));
-    mcmc_memory_unit_list_head->time_stamp = 0;
-    mcmc_memory_unit_list_head->iter_stamp = 0;
-    mcmc_memory_unit_list_head->next = NULL;
-    mcmc_memory_unit_list_curr = mcmc_memory_unit_list_head;
+static void mcmc_memory_unit_free(mcmc_ctx_t *ctx, vka_t *vka, mcmc_memory_unit_t *unit)
+{
+    /**
+     * We now try to cleanup the original untyped's metadata:
+     *  1. capability slot bookkeeping overhead
+     *  2. kernel object itself (by means of calling vka_free_object)
+     *  3. vka_object_t (at userlevel to describe it)
+    */
+    vka_free_object(vka, unit->compressed_frames);
+    mcmc_slab_free(&ctx->object_slab, unit->compressed_frames);
+}
 
-    mcmc_memory_unit_t *tx;
-    mcmc_memory_unit_t *tp;
+#ifdef CONFIG_MRMC_MEMORY_SERVER
+/**
+ * Copy the first 'frame_count' frames of a unit (of the 'unit_frames' it
+ * was retyped with) into consecutive slots from 'slot', see
+ * mcmc_server_grant. They sit in consecutive slots from the one of the
+ * block.
+ */
+static int mcmc_memory_unit_grant(vka_t *vka, mcmc_memory_unit_t *unit, uint32_t unit_frames UNUSED,
+                                  uint32_t frame_count, cspacepath_t slot)
+{
+    cspacepath_t frame;
 
-    for (; i < MCMC_ITERATION_TIME; ++i)
+    for (uint32_t f = 0; f < frame_count; ++f, ++slot.capPtr)
     {
-        ta_time_stamp = get_random_time(MCMC_FREE_FREQUENCY) + i;
-        ta_frame_count = get_random_size_policy_2();
-        ta_block_size = CTZL(ta_frame_count) + seL4_PageBits;
-        /**
-         * original untyped object (size: ta_block_size)
-         */
-        tx = (mcmc_memory_unit_t *)malloc(sizeof(mcmc_memory_unit_t));
-        memset(tx, 0, sizeof(*tx));
-        /**
-         * new memory unit metadata initialization:
-        */
-        tx->iter_stamp = i;
-        tx->time_stamp = ta_time_stamp;
-        tx->compressed_frames = (vka_object_t *)malloc(sizeof(vka_object_t));
-        memset(tx->compressed_frames, 0, sizeof(*tx->compressed_frames));
-        /**
-         * We should now allocate frames in here.
-         * by means of calling 'vka_alloc_frame_contiguous' can we benefit from
-         * allocating contiguous frames in bulk.
-        */
-        mcmc_errno = vka_alloc_frame_contiguous(vka, ta_block_size, &ta_frame_sanitizer, tx->compressed_frames);
-        if (mcmc_errno) {
-            printf("[DONE]: total %d iteration %d\n", total - ta_frame_count, i - 1);
-            assert(0);
+        vka_cspace_make_path(vka, unit->compressed_frames->cptr + f, &frame);
+        int err = vka_cnode_copy(&slot, &frame, seL4_AllRights);
+        if (err) {
+            return err;
         }
+    }
+    return seL4_NoError;
+}
+#endif
 
-        assert(ta_frame_sanitizer == ta_frame_count);
-
-        mcmc_memory_unit_list_curr->next = tx;
-        mcmc_memory_unit_list_curr = tx;
+#ifdef CONFIG_MRMC_MAP_TOUCH
+/***
+ * Large pages: vka_alloc_frame_contiguous retypes all the frames of a block
+ * in one go, out of one untyped of the size of the block (the split node
+ * behind the cookie of compressed_frames), into consecutive slots starting
+ * at compressed_frames->cptr. A block of at least one large page whose base
+ * is aligned to one is mapped with large pages instead: its frames are
+ * revoked off the untyped, which is retyped into large pages, and once the
+ * block is unmapped again the large pages make way for the very frames it
+ * was handed out with, so as vka gets back what it gave.
+ */
+static inline struct utspace_split_node *mcmc_block_untyped(mcmc_memory_unit_t *unit)
+{
+    return (struct utspace_split_node *)unit->compressed_frames->ut;
+}
 
-        tx = mcmc_memory_unit_list_head;
-        tp = tx->next;
+/* Retype the untyped of a block into its frames again, into the slots they came in */
+static int mcmc_block_frames_retype(vka_t *vka, mcmc_memory_unit_t *unit)
+{
+    vka_object_t untyped = { .cptr = mcmc_block_untyped(unit)->ut.capPtr };
+    seL4_Word frame_type = kobject_get_type(KOBJECT_FRAME, seL4_PageBits);
+    uint32_t frame_count = BIT(mcmc_memory_unit_order(unit));
+    cspacepath_t tc;
 
-        while (tp)
-        {
-            if (tp->iter_stamp > i) {
-                break;
-            }
-            if (tp->time_stamp == i)
-            {
-                /**
-                 * We now try to cleanup the original untyped's metadata:
-                 *  1. capability slot bookkeeping overhead
-                 *  2. kernel object itself (by means of calling vka_free_object)
-                 *  3. vka_object_t (at userlevel to describe it)
-                */
-                vka_free_object(vka, tp->compressed_frames);
-                free(tp->compressed_frames);
-                /**
-                 * tp = tx->next
-                 * so we should free current tp, move tp forward and let tx->next equals to new tp
-                */
-                tp = tp->next;
-                free(tx->next);
-                tx->next = tp;
-            } else {
-                tx = tp;
-                tp = tp->next;                
-            }
+    for (uint32_t j = 0; j < frame_count; j += CONFIG_RETYPE_FAN_OUT_LIMIT)
+    {
+        vka_cspace_make_path(vka, unit->compressed_frames->cptr + j, &tc);
+        int err = vka_untyped_retype(&untyped, frame_type, seL4_PageBits,
+                                     MIN(frame_count - j, CONFIG_RETYPE_FAN_OUT_LIMIT), &tc);
+        if (err) {
+            return err;
         }
-        total += ta_frame_count;
     }
-    printf("[DONE]: total %d iteration %d\n", total, i);
-    return 0;
+    return seL4_NoError;
 }
 
-#else
+/* Delete the large pages of a block, if any, and retype its frames again */
+static void mcmc_large_pages_drop(vka_t *vka, mcmc_memory_unit_t *unit)
+{
+    /* The untyped is then as vka_alloc_frame_contiguous got it */
+    int err = vka_cnode_revoke(&mcmc_block_untyped(unit)->ut);
 
-typedef struct mcmc_frame_unit {
+    for (uint32_t p = 0; p < unit->large_page_count; ++p)
+    {
+        vka_cspace_free(vka, unit->large_pages[p]);
+    }
+    unit->large_page_count = 0;
+    if (err == seL4_NoError) {
+        err = mcmc_block_frames_retype(vka, unit);
+    }
+    if (err) {
+        ZF_LOGF("Failed to give the frames of a block back after large pages");
+    }
+}
+
+/**
+ * Turn the block of a unit into large pages, if it is large and aligned
+ * enough for them.
+ *
+ * @return true if the unit is now held by unit->large_pages.
+ */
+static bool mcmc_large_pages_make(vka_t *vka, mcmc_memory_unit_t *unit)
+{
+    seL4_Word page_type = kobject_get_type(KOBJECT_FRAME, seL4_LargePageBits);
+    int order = mcmc_memory_unit_order(unit);
+    struct utspace_split_node *node = mcmc_block_untyped(unit);
+    vka_object_t untyped = { .cptr = node->ut.capPtr };
+    cspacepath_t tc;
+
+    unit->large_page_count = 0;
+    if (order < MCMC_LARGE_PAGE_ORDER || (node->paddr & MASK(seL4_LargePageBits))) {
+        return false;
+    }
+    if (vka_cnode_revoke(&node->ut)) {
+        ZF_LOGF("Failed to revoke the frames of a block for large pages");
+    }
+    for (size_t p = 0; p < BIT(order - MCMC_LARGE_PAGE_ORDER); ++p)
+    {
+        int err = vka_cspace_alloc(vka, &unit->large_pages[p]);
+        if (err == seL4_NoError) {
+            vka_cspace_make_path(vka, unit->large_pages[p], &tc);
+            err = vka_untyped_retype(&untyped, page_type, seL4_LargePageBits, 1, &tc);
+            if (err) {
+                vka_cspace_free(vka, unit->large_pages[p]);
+            }
+        }
+        if (err) {
+            /* Back to the frames, without the large pages retyped so far */
+            mcmc_large_pages_drop(vka, unit);
+            return false;
+        }
+        unit->large_page_count++;
+    }
+    return true;
+}
+
+/**
+ * Caps of the pages that hold the first 'frame_count' frames of a unit,
+ * into 'caps', and their size into 'page_bits': large pages where the
+ * block allows, see mcmc_large_pages_make, else its frames.
+ *
+ * @return the number of pages.
+ */
+static size_t mcmc_memory_unit_pages(vka_t *vka, mcmc_memory_unit_t *unit, uint32_t frame_count,
+                                     seL4_CPtr *caps, size_t *page_bits)
+{
+    if (mcmc_large_pages_make(vka, unit)) {
+        size_t pages = DIV_ROUND_UP(frame_count, BIT(MCMC_LARGE_PAGE_ORDER));
+
+        for (size_t p = 0; p < pages; ++p)
+        {
+            caps[p] = unit->large_pages[p];
+        }
+        *page_bits = seL4_LargePageBits;
+        return pages;
+    }
+    for (uint32_t f = 0; f < frame_count; ++f)
+    {
+        caps[f] = unit->compressed_frames->cptr + f;
+    }
+    *page_bits = seL4_PageBits;
+    return frame_count;
+}
+
+/* Undo mcmc_memory_unit_pages once the unit is unmapped */
+static void mcmc_memory_unit_unpages(vka_t *vka, mcmc_memory_unit_t *unit)
+{
+    if (unit->large_page_count) {
+        mcmc_large_pages_drop(vka, unit);
+    }
+}
+#endif
+
+#if defined(CONFIG_MRMC_SAMPLE_PROBE) || defined(MCMC_MULTI_RUN)
+/* Allocate a bare block of 2^order frames, through the very same path as memory units take */
+static int mcmc_block_alloc(vka_t *vka, int order, vka_object_t *block)
+{
+    uint32_t frame_sanitizer;
+
+    return vka_alloc_frame_contiguous(vka, order + seL4_PageBits, &frame_sanitizer, block);
+}
+#endif
+
+#else
+
+typedef struct mcmc_frame_unit {
     seL4_CPtr frame_cptr;
     struct mcmc_frame_unit *next;
 } mcmc_frame_unit_t;
 
 typedef struct mcmc_memory_unit {
     /**
-     * We use time_stamp to denote when this piece of memory unit
-     * is allocated in case that we can free it later on.
+     * Memory units are queued in the expiry wheel, and node.expiry is the
+     * time_stamp (iteration) at which this piece of memory unit should be
+     * freed. It must be the first member, see mcmc_memory_unit_of.
      */
-    size_t time_stamp;
+    mcmc_wheel_node_t node;
 
     size_t iter_stamp;
     /**
@@ -381,224 +1061,2903 @@ typedef struct mcmc_memory_unit {
      *   frame_number = (origin_untyped_object->size_bits / seL4_PageBits);
      */
     vka_object_t *origin_untyped_object;
+#ifdef CONFIG_MRMC_OBJECT_MIX
+    /* MCMC_OBJECT_FRAMES, or the kind of the kernel object in 'object' instead */
+    int kind;
+    vka_object_t object;
+#endif
+#ifdef CONFIG_MRMC_BULK_RETYPE
+    /**
+     * frame_cnode: one CNode (from mcmc_frame_cnodes) whose first slots hold
+     * all the frames retyped from the original untyped, in slot order.
+     */
+    vka_object_t *frame_cnode;
+#else
     /**
      * frame_cptr_list (length): size of original untyped object divide seL4_PageBits
      *   Let's say: origin 32k -> 15, frame_cptr_list length: pow(2, 15-12) = 2^3 = 8
      */
     mcmc_frame_unit_t *frame_cptr_list;
-    /**
-     * All mcmc_memory_unit will have to construct a list.
-     */
-    struct mcmc_memory_unit *next;
+#endif
+#ifdef CONFIG_MRMC_MAGAZINE
+    /* frames retyped out of the untyped, for units reused from the magazine */
+    uint32_t frame_count;
+#endif
+#ifdef CONFIG_MRMC_MAP_TOUCH
+    mcmc_mapping_t mapping;
+#endif
 
 } mcmc_memory_unit_t;
 
-static mcmc_memory_unit_t *mcmc_memory_unit_list_head;
-static mcmc_memory_unit_t *mcmc_memory_unit_list_curr;
+#define mcmc_memory_unit_order(unit) ((unit)->origin_untyped_object->size_bits - seL4_PageBits)
+#define mcmc_memory_unit_block(unit) ((unit)->origin_untyped_object)
+
+#ifdef CONFIG_MRMC_BULK_RETYPE
+
+/**
+ * Bulk-retype mode: every memory unit borrows one CNode that is large enough
+ * for the largest request, and all of its frames are retyped into a contiguous
+ * run of slots of that CNode by as few seL4_Untyped_Retype invocations as
+ * KernelRetypeFanOutLimit allows (one, for KernelRetypeFanOutLimit >= 1024).
+ *
+ * The CNodes are allocated before the timed region, so the slot allocation
+ * of the cspace allocator is out of the picture entirely. Revoking the
+ * original untyped deletes the frames from the CNode again.
+ *
+ * That is 2^MCMC_FRAME_CNODE_BITS cslots of memory per outstanding unit,
+ * far too many at the loads of MRMCScaling and MRMCCapacitySearch, which
+ * are therefore not available along with MRMCBulkRetype.
+ */
+#define MCMC_FRAME_CNODE_BITS MCMC_MAX_ORDER
 
-static int mcmc_exp_simulation()
+static void *mcmc_pages_reserve(size_t bytes);
+
+static void mcmc_frame_cnode_init(mcmc_ctx_t *ctx, vka_t *vka, size_t count)
 {
-    vka_t *vka = &env.vka;
-    seL4_Word frame_type = kobject_get_type(KOBJECT_FRAME, 12);
-    size_t memory_footprint = 0;
-    int mcmc_errno = seL4_NoError;
+    vka_object_t *cnodes = (vka_object_t *)mcmc_pages_reserve(count * sizeof(vka_object_t));
+
+    ctx->frame_cnode_pool = (vka_object_t **)mcmc_pages_reserve(count * sizeof(vka_object_t *));
+    for (size_t i = 0; i < count; ++i)
+    {
+        int err = vka_alloc_cnode_object(vka, MCMC_FRAME_CNODE_BITS, &cnodes[i]);
+        if (err) {
+            ZF_LOGF("Failed to allocate CNode for bulk retype");
+        }
+        ctx->frame_cnode_pool[i] = &cnodes[i];
+    }
+    ctx->frame_cnode_top = count;
+}
+
+static int mcmc_frames_retype(mcmc_ctx_t *ctx, vka_t *vka, mcmc_memory_unit_t *unit, uint32_t frame_count)
+{
+    seL4_Word frame_type = kobject_get_type(KOBJECT_FRAME, seL4_PageBits);
+    cspacepath_t tc;
+    int err;
 
-    int i = 1;
-    size_t total = 0;
+    if (ctx->frame_cnode_top == 0) {
+        unit->frame_cnode = NULL;
+        return seL4_NotEnoughMemory;
+    }
+    unit->frame_cnode = ctx->frame_cnode_pool[--ctx->frame_cnode_top];
     /**
-     * ta: to-allocate;
-     * tf: to-free;
-     * time_stamp: a point within the MCMC time serie.
-     * frame_count: number of frames to alloc/free at this time.
+     * Retype into the slots of the borrowed CNode rather than into
+     * the slot named by the path (as vka_untyped_retype does by default).
      */
-    int ta_time_stamp, ta_frame_count, ta_block_size;
+    vka_cspace_make_path(vka, unit->frame_cnode->cptr, &tc);
+    tc.dest = tc.capPtr;
+    tc.destDepth = tc.capDepth;
+
+    for (uint32_t j = 0; j < frame_count; j += CONFIG_RETYPE_FAN_OUT_LIMIT)
+    {
+        tc.offset = j;
+        err = vka_untyped_retype(unit->origin_untyped_object, frame_type, seL4_PageBits,
+                                 MIN(frame_count - j, CONFIG_RETYPE_FAN_OUT_LIMIT), &tc);
+        if (err) {
+            /* The revoke of mcmc_memory_unit_free deletes the frames retyped so far */
+            return err;
+        }
+    }
+    return seL4_NoError;
+}
 
-    mcmc_memory_unit_list_head = (mcmc_memory_unit_t *)malloc(sizeof(mcmc_memory_unit_t));
-    mcmc_memory_unit_list_head->time_stamp = 0;
-    mcmc_memory_unit_list_head->iter_stamp = 0;
-    mcmc_memory_unit_list_head->next = NULL;
-    mcmc_memory_unit_list_curr = mcmc_memory_unit_list_head;
+static void mcmc_frames_release(mcmc_ctx_t *ctx, vka_t *vka UNUSED, mcmc_memory_unit_t *unit)
+{
+    /* The frames are gone after the revoke, so the CNode is empty again */
+    if (unit->frame_cnode) {
+        ctx->frame_cnode_pool[ctx->frame_cnode_top++] = unit->frame_cnode;
+    }
+}
 
-    mcmc_memory_unit_t *tx;
-    mcmc_memory_unit_t *tp;
+#else
+
+static int mcmc_frames_retype(mcmc_ctx_t *ctx, vka_t *vka, mcmc_memory_unit_t *unit, uint32_t frame_count)
+{
+    seL4_Word frame_type = kobject_get_type(KOBJECT_FRAME, seL4_PageBits);
     cspacepath_t tc;
+    int err;
+    /**
+     * We now need to allocate all frames from the original untyped.
+    */
+    mcmc_frame_unit_t *ft = NULL;
 
-    for (; i <= MCMC_ITERATION_TIME; ++i)
+    /* Frames are listed as soon as they exist, so as a failure can give them back */
+    unit->frame_cptr_list = NULL;
+    for (int j = 0; j < frame_count; ++j)
     {
-        ta_time_stamp = get_random_time(MCMC_FREE_FREQUENCY) + i;
-        ta_frame_count = get_random_size_policy_2();
-        ta_block_size = CTZL(ta_frame_count) + seL4_PageBits;
-        /**
-         * original untyped object (size: ta_block_size)
-         */
-        tx = (mcmc_memory_unit_t *)malloc(sizeof(mcmc_memory_unit_t));
-        memset(tx, 0, sizeof(*tx));
+        ft = (mcmc_frame_unit_t *)mcmc_slab_alloc(&ctx->frame_slab);
+        if (ft == NULL) {
+            return seL4_NotEnoughMemory;
+        }
 
-        tx->iter_stamp = i;
-        tx->time_stamp = ta_time_stamp;
-        tx->origin_untyped_object = (vka_object_t *)malloc(sizeof(vka_object_t));
-        memset(tx->origin_untyped_object, 0, sizeof(*tx->origin_untyped_object));
+        err = vka_cspace_alloc(vka, &ft->frame_cptr);
+        if (err) {
+            /* Out of cslots */
+            mcmc_slab_free(&ctx->frame_slab, ft);
+            return err;
+        }
+        vka_cspace_make_path(vka, ft->frame_cptr, &tc);
         /**
-         * We need to allocate one untyped object (with ta_block_size) first.
-         * This is because cascading split-based buddy allocator will allocate
-         * frames distributingly if the frames are not from one untyped object.
-        */
-        mcmc_errno = vka_alloc_object(vka, seL4_UntypedObject, ta_block_size, tx->origin_untyped_object);
-        if (mcmc_errno) {
-            printf("[DONE]: total %d iteration %d\n", total - ta_frame_count, i - 1);
-            assert(0); // abort as error handling (temporarily)
+         * create the j(th) frame through untyped retyped.
+         * (It's okay to clean / delete these frames through revoke).
+         */
+        err = vka_untyped_retype(unit->origin_untyped_object, frame_type, seL4_PageBits, 1, &tc);
+        if (err) {
+            vka_cspace_free(vka, ft->frame_cptr);
+            mcmc_slab_free(&ctx->frame_slab, ft);
+            return err;
         }
+        ft->next = unit->frame_cptr_list;
+        unit->frame_cptr_list = ft;
+    }
+    return seL4_NoError;
+}
+
+static void mcmc_frames_release(mcmc_ctx_t *ctx, vka_t *vka, mcmc_memory_unit_t *unit)
+{
+    mcmc_frame_unit_t *ft = unit->frame_cptr_list;
+    mcmc_frame_unit_t *fl = ft;
+    /**
+     * We should free capability bookkeeping message from cspace
+     * manager (cspace-allocator) for every frames.
+    */
+    while (ft)
+    {
+        vka_cspace_free(vka, ft->frame_cptr);
         /**
-         * We now need to allocate all frames from the original untyped.
+         * We should free user-level bookkeeping metadata for the
+         * frames in here. (after we freeing it within cspace-allocator)
         */
-        mcmc_frame_unit_t *ft = NULL;
-        mcmc_frame_unit_t *fl = NULL;
+        ft = ft->next;
+        mcmc_slab_free(&ctx->frame_slab, fl);
+        fl = ft;
+    }
+}
 
-        for (int j = 0; j < ta_frame_count; ++j)
-        {
-            ft = (mcmc_frame_unit_t *)malloc(sizeof(mcmc_frame_unit_t));
-            memset(ft, 0, sizeof(*ft));
+#endif
 
-            mcmc_errno = vka_cspace_alloc(vka, &ft->frame_cptr);
-            if (mcmc_errno) {
-                assert(0);
-            }
-            vka_cspace_make_path(vka, ft->frame_cptr, &tc);
-            /**
-             * create the j(th) frame through untyped retyped.
-             * (It's okay to clean / delete these frames through revoke).
-             */
-            mcmc_errno = vka_untyped_retype(tx->origin_untyped_object, frame_type, seL4_PageBits, 1, &tc);
-            if (mcmc_errno) {
-                assert(0);
-            }
-            if (fl) {
-                ft->next = fl;
-            }
-            fl = ft;
+static void mcmc_memory_unit_free(mcmc_ctx_t *ctx, vka_t *vka, mcmc_memory_unit_t *unit);
+
+static int mcmc_memory_unit_alloc(mcmc_ctx_t *ctx, vka_t *vka, mcmc_memory_unit_t *unit, uint32_t frame_count)
+{
+    int block_size = mcmc_frame_order(frame_count) + seL4_PageBits;
+
+    unit->origin_untyped_object = (vka_object_t *)mcmc_slab_alloc(&ctx->object_slab);
+    if (unit->origin_untyped_object == NULL) {
+        return seL4_NotEnoughMemory;
+    }
+    /**
+     * We need to allocate one untyped object (with block_size) first.
+     * This is because cascading split-based buddy allocator will allocate
+     * frames distributingly if the frames are not from one untyped object.
+     * Only 'frame_count' frames are retyped from it, so requests which are
+     * not a power of two leave the tail of the untyped unused.
+    */
+    int err = vka_alloc_object(vka, seL4_UntypedObject, block_size, unit->origin_untyped_object);
+    if (err) {
+        mcmc_slab_free(&ctx->object_slab, unit->origin_untyped_object);
+        return err;
+    }
+#ifdef CONFIG_MRMC_MAGAZINE
+    unit->frame_count = frame_count;
+#endif
+    err = mcmc_frames_retype(ctx, vka, unit, frame_count);
+    if (err) {
+        /* Give back the frames retyped so far, and the untyped */
+        mcmc_memory_unit_free(ctx, vka, unit);
+    }
+    return err;
+}
+
+static void mcmc_memory_unit_free(mcmc_ctx_t *ctx, vka_t *vka, mcmc_memory_unit_t *unit)
+{
+    cspacepath_t tc;
+    /**
+     * We should now revoke these frame capabilities within seL4
+     * through calling seL4_CNode_Revoke on original untyped obj's cap
+    */
+    vka_cspace_make_path(vka, unit->origin_untyped_object->cptr, &tc);
+    int err = vka_cnode_revoke(&tc);
+    if (err) {
+        assert(0);
+    }
+    mcmc_frames_release(ctx, vka, unit);
+    /**
+     * We now try to cleanup the original untyped's metadata:
+     *  1. capability slot bookkeeping overhead
+     *  2. kernel object itself (by means of calling vka_free_object)
+     *  3. vka_object_t (at userlevel to describe it)
+    */
+    vka_free_object(vka, unit->origin_untyped_object);
+    mcmc_slab_free(&ctx->object_slab, unit->origin_untyped_object);
+}
+
+#ifdef CONFIG_MRMC_MEMORY_SERVER
+/**
+ * Copy the first 'frame_count' frames of a unit (of the 'unit_frames' it
+ * was retyped with) into consecutive slots from 'slot', see
+ * mcmc_server_grant.
+ */
+static int mcmc_memory_unit_grant(vka_t *vka, mcmc_memory_unit_t *unit, uint32_t unit_frames,
+                                  uint32_t frame_count, cspacepath_t slot)
+{
+    cspacepath_t frame;
+    int err;
+
+#ifdef CONFIG_MRMC_BULK_RETYPE
+    /* In slot order of the borrowed CNode */
+    for (uint32_t f = 0; f < frame_count; ++f, ++slot.capPtr)
+    {
+        frame = (cspacepath_t) {
+            .root = unit->frame_cnode->cptr,
+            .capPtr = f,
+            .capDepth = MCMC_FRAME_CNODE_BITS,
+        };
+        err = vka_cnode_copy(&slot, &frame, seL4_AllRights);
+        if (err) {
+            return err;
         }
-        tx->frame_cptr_list = ft;
-        /**
-         * Add 'tx' into memory_unit_list
-        */
-        mcmc_memory_unit_list_curr->next = tx;
-        mcmc_memory_unit_list_curr = tx;
-        /**
-         *  Free operations start here:
-        */
-        tx = mcmc_memory_unit_list_head;
-        tp = tx->next;
-        
-        while (tp)
-        {
-            if (tp->iter_stamp > i) {
-                break;
-            }
-            if (tp->time_stamp == i)
-            {
-                /**
-                 * We should now revoke these frame capabilities within seL4
-                 * through calling seL4_CNode_Revoke on original untyped obj's cap
-                */
-                vka_cspace_make_path(vka, tp->origin_untyped_object->cptr, &tc);
-                mcmc_errno = vka_cnode_revoke(&tc);
-                if (mcmc_errno) {
-                    assert(0);
-                }
-                ft = tp->frame_cptr_list;
-                fl = ft;
-                /**
-                 * We should free capability bookkeeping message from cspace
-                 * manager (cspace-allocator) for every frames.
-                */
-                while (ft)
-                {
-                    vka_cspace_free(vka, ft->frame_cptr);
-                    /**
-                     * We should free user-level bookkeeping metadata for the
-                     * frames in here. (after we freeing it within cspace-allocator)
-                    */
-                    ft = ft->next;
-                    free(fl);
-                    fl = ft;
-                }
-                /**
-                 * We now try to cleanup the original untyped's metadata:
-                 *  1. capability slot bookkeeping overhead
-                 *  2. kernel object itself (by means of calling vka_free_object)
-                 *  3. vka_object_t (at userlevel to describe it)
-                */
-                vka_free_object(vka, tp->origin_untyped_object);
-                free(tp->origin_untyped_object);
-                /**
-                 * tp = tx->next
-                 * so we should free current tp, move tp forward and let tx->next equals to new tp
-                */
-                tp = tp->next;
-                free(tx->next);
-                tx->next = tp;
-            } else {
-                tx = tp;
-                tp = tp->next;                
-            }
+    }
+#else
+    /* The list is in reverse order of retyping */
+    uint32_t f = unit_frames;
+    for (mcmc_frame_unit_t *ft = unit->frame_cptr_list; ft; ft = ft->next)
+    {
+        if (--f >= frame_count) {
+            continue;
+        }
+        cspacepath_t to = slot;
+        to.capPtr += f;
+        vka_cspace_make_path(vka, ft->frame_cptr, &frame);
+        err = vka_cnode_copy(&to, &frame, seL4_AllRights);
+        if (err) {
+            return err;
         }
-        total += ta_frame_count;
     }
-    printf("[DONE]: total %d iteration %d\n", total, i);
-    return 0;
+#endif
+    return seL4_NoError;
+}
+#endif
+
+#ifdef CONFIG_MRMC_MAP_TOUCH
+/**
+ * Caps of the pages that hold the first 'frame_count' frames of a unit,
+ * into 'caps', and their size into 'page_bits'. The frames are retyped one
+ * by one into slots of their own, and only as many as requested, so they
+ * are mapped one by one as well.
+ *
+ * @return the number of pages.
+ */
+static size_t mcmc_memory_unit_pages(vka_t *vka UNUSED, mcmc_memory_unit_t *unit, uint32_t frame_count,
+                                     seL4_CPtr *caps, size_t *page_bits)
+{
+    size_t f = frame_count;
+
+    /* The list is in reverse order of retyping */
+    for (mcmc_frame_unit_t *ft = unit->frame_cptr_list; ft; ft = ft->next)
+    {
+        caps[--f] = ft->frame_cptr;
+    }
+    *page_bits = seL4_PageBits;
+    return frame_count;
 }
 
+static inline void mcmc_memory_unit_unpages(vka_t *vka UNUSED, mcmc_memory_unit_t *unit UNUSED) {}
 #endif
 
-void *__func_entry(void *arg UNUSED)
+#if defined(CONFIG_MRMC_SAMPLE_PROBE) || defined(CONFIG_MRMC_FREE_EPOCH) || defined(MCMC_MULTI_RUN)
+/**
+ * Allocate a bare untyped block of 2^order frames. The frames themselves
+ * need no allocating, as they are always retyped from such an untyped.
+ */
+static int mcmc_block_alloc(vka_t *vka, int order, vka_object_t *block)
 {
-    int err;
-    printf("\n>>>>>>>> __func_entry__ <<<<<<<\n");
-#ifdef CONFIG_KERNEL_BENCHMARK
-    printf("\n*********** Benchmark ***********\n\n");
-    uint64_t *ipcbuffer = (uint64_t *)&(seL4_GetIPCBuffer()->msg[0]);
-    seL4_BenchmarkResetThreadUtilisation(simple_get_tcb(&env.simple));
-    seL4_BenchmarkResetLog();
+    return vka_alloc_object(vka, seL4_UntypedObject, order + seL4_PageBits, block);
+}
 #endif
-    err = mcmc_exp_simulation();
-    if (err != seL4_NoError) {
+
+#ifdef CONFIG_MRMC_MAGAZINE
+/**
+ * Reuse a unit of the right order from the magazine for 'frame_count'
+ * frames. Its frames are kept if there are just as many of them, else the
+ * untyped is revoked and retyped afresh (still saving the untyped alloc/free).
+ */
+static int mcmc_memory_unit_reuse(mcmc_ctx_t *ctx, vka_t *vka, mcmc_memory_unit_t *unit, uint32_t frame_count)
+{
+    cspacepath_t tc;
+
+    if (unit->frame_count == frame_count) {
+        return seL4_NoError;
+    }
+    vka_cspace_make_path(vka, unit->origin_untyped_object->cptr, &tc);
+    int err = vka_cnode_revoke(&tc);
+    if (err) {
         assert(0);
     }
-#ifdef CONFIG_KERNEL_BENCHMARK
-    seL4_BenchmarkFinalizeLog();
-    seL4_BenchmarkGetThreadUtilisation(simple_get_tcb(&env.simple));
-    printf("\n*********** Benchmark ***********\n");
-    printf("\nCPU cycles spent (TCB-Schedule): %llu\n", ipcbuffer[BENCHMARK_TCB_UTILISATION]);
-    printf("\nCPU cycles spent (TCB-Kernel): %llu\n", ipcbuffer[BENCHMARK_TCB_KERNEL_UTILISATION]);
+    mcmc_frames_release(ctx, vka, unit);
+    unit->frame_count = frame_count;
+    err = mcmc_frames_retype(ctx, vka, unit, frame_count);
+    if (err) {
+        mcmc_memory_unit_free(ctx, vka, unit);
+    }
+    return err;
+}
 #endif
-    printf("\n>>>>>>>> __func__exit__ <<<<<<<\n");
+
+#endif
+
+#ifdef CONFIG_MRMC_CALIBRATE
+/***
+ * Null backend: memory units only get the bookkeeping of the driver (slab
+ * entries, expiry wheel, the vka lock), a block of the right order in name
+ * only, and no kernel or allocator work at all. The very same workload run
+ * against it first tells apart the cycles of the driver from the ones of
+ * the allocator, see mcmc_calibrate_run.
+ */
+static bool mcmc_null_backend;
+
+static int mcmc_null_unit_alloc(mcmc_ctx_t *ctx, mcmc_memory_unit_t *unit, uint32_t frame_count)
+{
+    vka_object_t *block = (vka_object_t *)mcmc_slab_alloc(&ctx->object_slab);
+
+    if (block == NULL) {
+        return seL4_NotEnoughMemory;
+    }
+    block->size_bits = mcmc_frame_order(frame_count) + seL4_PageBits;
+    mcmc_memory_unit_block(unit) = block;
+    return seL4_NoError;
 }
 
-static void sel4test_exit(int code) {
-    /***
-     * Suspend first initial thread (which is the thread we are in)
-     * (add it into scheduling queue in kernel) through TCB_Suspend
-     * interface.
-     */
-    seL4_TCB_Suspend(seL4_CapInitThreadTCB);
+static void mcmc_null_unit_free(mcmc_ctx_t *ctx, mcmc_memory_unit_t *unit)
+{
+    mcmc_slab_free(&ctx->object_slab, mcmc_memory_unit_block(unit));
 }
+#endif
 
-int main(void)
+/* Allocate a memory unit from the allocator, or from the null backend while calibrating */
+static inline int mcmc_backend_alloc(mcmc_ctx_t *ctx, vka_t *vka, mcmc_memory_unit_t *unit, uint32_t frame_count)
 {
-    void *res;
-    sel4runtime_set_exit(sel4test_exit);
-    /***
-     * Receive bootinfo from sel4runtime, which is provided throughly
-     * by seL4 kernel, and use it to create & initial executing environment.
-     */
-    seL4_BootInfo *info = platsupport_get_bootinfo();
-    simple_default_init_bootinfo(&env.simple, info);
-    /***
-     * (Optional) To print the bootstrapping information.
-     */
-    if (config_set(CONFIG_MRMC_RESOURCE_INFO)) {
-        simple_print(&env.simple);
+#ifdef CONFIG_MRMC_CALIBRATE
+    if (mcmc_null_backend) {
+        return mcmc_null_unit_alloc(ctx, unit, frame_count);
+    }
+#endif
+    return mcmc_memory_unit_alloc(ctx, vka, unit, frame_count);
+}
+
+static inline void mcmc_backend_free(mcmc_ctx_t *ctx, vka_t *vka, mcmc_memory_unit_t *unit)
+{
+#ifdef CONFIG_MRMC_CALIBRATE
+    if (mcmc_null_backend) {
+        mcmc_null_unit_free(ctx, unit);
+        return;
+    }
+#endif
+    mcmc_memory_unit_free(ctx, vka, unit);
+}
+
+#define mcmc_memory_unit_of(wheel_node) ((mcmc_memory_unit_t *)(wheel_node))
+
+#ifdef CONFIG_MRMC_MAP_TOUCH
+/***
+ * Map-and-touch: every allocated unit is mapped into the rootserver through
+ * env.vspace and each of its frames written to, then unmapped again before
+ * it expires, so as what it takes to make the memory usable is measured
+ * along with what it takes to allocate it. This happens outside the alloc
+ * and free latency histograms. The vspace allocates paging structures from
+ * env.vka whenever a mapping needs them and keeps them afterwards, so they
+ * are counted by wrapping the utspace allocation of vka, see mcmc_map_attach.
+ * Both allocators hand out frames of seL4_PageBits. Cascading units are
+ * mapped one page per frame, while aligned CapBuddy blocks of at least one
+ * large page are mapped with large pages (see mcmc_large_pages_make), and
+ * need no page table underneath. Turning a block into large pages and back
+ * is counted apart from the mapping, in large_page_cycles.
+ */
+static vka_t mcmc_map_vka;
+static bool mcmc_mapping;
+static size_t mcmc_paging_objects;
+
+static void mcmc_map_count(seL4_Word type)
+{
+    /* Bookkeeping pages of the vspace aside, all it allocates are paging structures */
+    if (mcmc_mapping && type != kobject_get_type(KOBJECT_FRAME, seL4_PageBits)) {
+        mcmc_paging_objects++;
+    }
+}
+
+static int mcmc_map_utspace_alloc(void *data, const cspacepath_t *dest, seL4_Word type,
+                                  seL4_Word size_bits, seL4_Word *res)
+{
+    mcmc_map_count(type);
+    return mcmc_map_vka.utspace_alloc(data, dest, type, size_bits, res);
+}
+
+static int mcmc_map_utspace_alloc_maybe_device(void *data, const cspacepath_t *dest, seL4_Word type,
+                                               seL4_Word size_bits, bool can_use_dev, seL4_Word *res)
+{
+    mcmc_map_count(type);
+    return mcmc_map_vka.utspace_alloc_maybe_device(data, dest, type, size_bits, can_use_dev, res);
+}
+
+static void mcmc_map_attach(vka_t *vka)
+{
+    mcmc_map_vka = *vka;
+    vka->utspace_alloc = mcmc_map_utspace_alloc;
+    if (vka->utspace_alloc_maybe_device) {
+        vka->utspace_alloc_maybe_device = mcmc_map_utspace_alloc_maybe_device;
+    }
+}
+
+static int mcmc_memory_unit_map(mcmc_ctx_t *ctx, vka_t *vka, mcmc_memory_unit_t *unit, uint32_t frame_count)
+{
+    size_t paging_objects = mcmc_paging_objects;
+    size_t page_bits;
+    ccnt_t start = sel4bench_get_cycle_count();
+    size_t pages = mcmc_memory_unit_pages(vka, unit, frame_count, ctx->map_caps, &page_bits);
+
+    ctx->result.large_page_cycles += sel4bench_get_cycle_count() - start;
+    start = sel4bench_get_cycle_count();
+    mcmc_mapping = true;
+    void *vaddr = vspace_map_pages(&env.vspace, ctx->map_caps, NULL, seL4_AllRights, pages, page_bits, 1);
+    mcmc_mapping = false;
+    if (vaddr == NULL) {
+        mcmc_memory_unit_unpages(vka, unit);
+        return seL4_NotEnoughMemory;
     }
+    for (uint32_t f = 0; f < frame_count; ++f)
+    {
+        *(volatile seL4_Word *)((uintptr_t)vaddr + ((uintptr_t)f << seL4_PageBits)) = f;
+    }
+    ctx->result.map_cycles += sel4bench_get_cycle_count() - start;
+    ctx->result.paging_objects += mcmc_paging_objects - paging_objects;
+    ctx->result.mapped_pages += pages;
+    if (page_bits != seL4_PageBits) {
+        ctx->result.mapped_large_pages += pages;
+    }
+    unit->mapping.vaddr = vaddr;
+    unit->mapping.pages = pages;
+    unit->mapping.page_bits = page_bits;
+    return seL4_NoError;
+}
+
+static void mcmc_memory_unit_unmap(mcmc_ctx_t *ctx, vka_t *vka, mcmc_memory_unit_t *unit)
+{
+    ccnt_t start = sel4bench_get_cycle_count();
+
+    vspace_unmap_pages(&env.vspace, unit->mapping.vaddr, unit->mapping.pages,
+                       unit->mapping.page_bits, VSPACE_PRESERVE);
+    ctx->result.unmap_cycles += sel4bench_get_cycle_count() - start;
+    start = sel4bench_get_cycle_count();
+    mcmc_memory_unit_unpages(vka, unit);
+    ctx->result.large_page_cycles += sel4bench_get_cycle_count() - start;
+}
+#endif
+
+#if defined(CONFIG_MRMC_SAMPLE_PROBE) || defined(CONFIG_MRMC_FREE_EPOCH)
+/* Check whether a block of 2^order frames is allocatable right now, and give it back immediately */
+static bool mcmc_memory_probe(vka_t *vka, int order)
+{
+    vka_object_t probe = {0};
+
+    if (mcmc_block_alloc(vka, order, &probe)) {
+        return false;
+    }
+    vka_free_object(vka, &probe);
+    return true;
+}
+
+/**
+ * Neither allocman nor CapBuddy expose their free lists through vka, so
+ * the largest allocatable order is found by binary search with real
+ * allocations (availability is monotone in a buddy system).
+ *
+ * @return the largest order allocatable right now, or MCMC_SAMPLE_EXHAUSTED.
+ */
+static int mcmc_largest_order(vka_t *vka)
+{
+    int lo = MCMC_SAMPLE_EXHAUSTED;
+    int hi = MCMC_MAX_ORDER;
+    /* invariant: lo is allocatable (or exhausted), everything above hi is not */
+    while (lo < hi)
+    {
+        int mid = (lo + hi + 1) / 2;
+        if (mcmc_memory_probe(vka, mid)) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return lo;
+}
+
+/**
+ * Probe the largest allocatable order in the middle of a run. The probe is
+ * none of the workload, so its cycles are counted into 'ctx' to be taken
+ * off the TCB utilisation and the cycles of the run again: the cycle
+ * counter for all of it, and the kernel utilisation of the thread for the
+ * kernel's share. Entries of the kernel log (MRMCKernelEntries) are not
+ * taken out.
+ */
+static int mcmc_probe_order(mcmc_ctx_t *ctx UNUSED, vka_t *vka)
+{
+#ifdef MCMC_PROBE_CYCLES
+#ifdef MCMC_TRACK_UTILISATION
+    uint64_t *ipcbuffer = (uint64_t *)&(seL4_GetIPCBuffer()->msg[0]);
+#ifdef CONFIG_MRMC_SMP_WORKERS
+    seL4_CPtr tcb = ctx->thread.tcb.cptr;
+#else
+    seL4_CPtr tcb = simple_get_tcb(&env.simple);
+#endif
+    seL4_BenchmarkGetThreadUtilisation(tcb);
+    uint64_t kernel_start = ipcbuffer[BENCHMARK_TCB_KERNEL_UTILISATION];
+#endif
+    ccnt_t start = sel4bench_get_cycle_count();
+#endif
+    int order = mcmc_largest_order(vka);
+#ifdef MCMC_PROBE_CYCLES
+    ctx->result.probe_cycles += sel4bench_get_cycle_count() - start;
+#ifdef MCMC_TRACK_UTILISATION
+    seL4_BenchmarkGetThreadUtilisation(tcb);
+    ctx->result.probe_kernel_cycles += ipcbuffer[BENCHMARK_TCB_KERNEL_UTILISATION] - kernel_start;
+#endif
+#endif
+    return order;
+}
+#endif
+
+/**
+ * Map fresh pages for driver bookkeeping. This consumes memory through the
+ * same vka as the simulation does, so it must happen before the timed region.
+ */
+static void *mcmc_pages_reserve(size_t bytes)
+{
+    size_t pages = (bytes + BIT(seL4_PageBits) - 1) >> seL4_PageBits;
+
+    void *mem = vspace_new_pages(&env.vspace, seL4_AllRights, pages ? pages : 1, seL4_PageBits);
+    if (mem == NULL) {
+        ZF_LOGF("Failed to reserve %zu pages for driver bookkeeping", pages);
+    }
+    return mem;
+}
+
+#ifdef CONFIG_MRMC_FREE_EPOCH
+static void mcmc_epoch_slack(size_t *units, size_t *frames);
+#endif
+
+static void mcmc_slab_reserve(mcmc_slab_t *slab, size_t obj_size, size_t capacity)
+{
+    mcmc_slab_init(slab, mcmc_pages_reserve(mcmc_slab_bytes(obj_size, capacity)), obj_size, capacity);
+}
+
+/**
+ * Reserve the arenas of one worker for at most 'units' outstanding memory
+ * units holding at most 'frames' frames altogether.
+ */
+static void mcmc_arena_init(mcmc_ctx_t *ctx, size_t units, size_t frames)
+{
+#ifdef CONFIG_MRMC_MAGAZINE
+    /* Units in the magazines keep their bookkeeping */
+    units += (MCMC_MAX_ORDER + 1) * CONFIG_MRMC_MAGAZINE_SIZE;
+    frames += (BIT(MCMC_MAX_ORDER + 1) - 1) * CONFIG_MRMC_MAGAZINE_SIZE;
+#endif
+#ifdef CONFIG_MRMC_FREE_EPOCH
+    /* So do units queued until the end of the epoch */
+    mcmc_epoch_slack(&units, &frames);
+#endif
+    mcmc_slab_reserve(&ctx->unit_slab, sizeof(mcmc_memory_unit_t), units);
+    mcmc_slab_reserve(&ctx->object_slab, sizeof(vka_object_t), units);
+#if !(ENABLE_CAPBUDDY_EXTENSION)
+#ifdef CONFIG_MRMC_BULK_RETYPE
+    mcmc_frame_cnode_init(ctx, &env.vka, units);
+#else
+    mcmc_slab_reserve(&ctx->frame_slab, sizeof(mcmc_frame_unit_t), frames);
+#endif
+#endif
+}
+
+/***
+ * Sources of memory requests: by default every iteration draws one request
+ * (size and expiry) at random. With MRMCTraceReplay, the requests come from
+ * a trace in the CPIO archive of the image instead, which is used in place,
+ * so as the timed loop only walks an array of fixed-size records. With
+ * MRMCTraceCapture, the random requests are recorded and dumped after the
+ * run, for tools/mrmc-trace.py to turn into a trace.
+ */
+#ifdef CONFIG_MRMC_TRACE_REPLAY
+extern char _cpio_archive[];
+extern char _cpio_archive_end[];
+
+static const mcmc_trace_header_t *mcmc_trace;
+
+static void mcmc_trace_load(void)
+{
+    unsigned long size = 0;
+    const void *data = cpio_get_file(_cpio_archive, _cpio_archive_end - _cpio_archive,
+                                     MCMC_TRACE_CPIO_NAME, &size);
+
+    mcmc_trace = mcmc_trace_check(data, size, MCMC_MAX_FRAME_COUNT);
+    if (mcmc_trace == NULL) {
+        ZF_LOGF("Invalid or missing trace '%s' in CPIO archive", MCMC_TRACE_CPIO_NAME);
+    }
+    printf("[TRACE]: replaying %u records over %u iterations\n",
+           mcmc_trace->records, mcmc_trace->iterations);
+}
+#endif
+
+#ifdef CONFIG_MRMC_TRACE_CAPTURE
+static mcmc_trace_record_t *mcmc_capture;
+static size_t mcmc_capture_count;
+
+static void mcmc_trace_capture_init(void)
+{
+    mcmc_capture = (mcmc_trace_record_t *)mcmc_pages_reserve(MCMC_ITERATION_TIME * sizeof(mcmc_trace_record_t));
+    mcmc_capture_count = 0;
+}
+
+static void mcmc_trace_capture_dump(void)
+{
+    mcmc_hex_dump("TRACE", mcmc_capture, mcmc_capture_count * sizeof(mcmc_trace_record_t), mcmc_capture_count);
+}
+#endif
+
+#ifdef CONFIG_MRMC_LATENCY_HISTOGRAM
+/**
+ * Cycles spent in every single alloc/free of a memory unit, keyed by the
+ * order (log2 of the frame count) of the unit. For CapBuddy, these are the
+ * vka_alloc_frame_contiguous/vka_free_object calls, for the cascading
+ * allocator the untyped alloc + retype loop and the revoke + cspace free loop.
+ * Every worker records into its own histograms, which are merged for the report.
+ */
+/* The histogram is picked at START, as the unit may be gone by END */
+#define MCMC_LATENCY_START(start, hist) \
+    mcmc_hist_t *start##_hist = (hist); ccnt_t start = sel4bench_get_cycle_count()
+#define MCMC_LATENCY_END(start) \
+    mcmc_hist_record(start##_hist, sel4bench_get_cycle_count() - (start))
+
+static void mcmc_latency_init(mcmc_ctx_t *ctx)
+{
+    for (int order = 0; order <= MCMC_MAX_ORDER; ++order)
+    {
+        mcmc_hist_init(&ctx->alloc_latency[order]);
+        mcmc_hist_init(&ctx->free_latency[order]);
+    }
+}
+
+static void mcmc_latency_print_one(const char *op, int order, const mcmc_hist_t *hist)
+{
+    mrmc_Record record = mrmc_Record_init_zero;
+
+    if (hist->count == 0) {
+        return;
+    }
+    record.which_payload = mrmc_Record_latency_tag;
+    strncpy(record.payload.latency.op, op, sizeof(record.payload.latency.op) - 1);
+    record.payload.latency.order = order;
+    record.payload.latency.count = hist->count;
+    record.payload.latency.sum = hist->sum;
+    record.payload.latency.p50 = mcmc_hist_quantile(hist, 500, 1000);
+    record.payload.latency.p99 = mcmc_hist_quantile(hist, 990, 1000);
+    record.payload.latency.p999 = mcmc_hist_quantile(hist, 999, 1000);
+    record.payload.latency.max = hist->max;
+    mcmc_result_append(&record);
+
+    printf("[LAT] %-5s order %2d count %8" PRIu64 " p50 %10" PRIu64 " p99 %10" PRIu64
+           " p99.9 %10" PRIu64 " max %10" PRIu64 "\n", op, order, hist->count,
+           record.payload.latency.p50, record.payload.latency.p99,
+           record.payload.latency.p999, hist->max);
+}
+
+static void mcmc_latency_print(void)
+{
+    static mcmc_hist_t alloc_latency[MCMC_MAX_ORDER + 1];
+    static mcmc_hist_t free_latency[MCMC_MAX_ORDER + 1];
+
+    for (int order = 0; order <= MCMC_MAX_ORDER; ++order)
+    {
+        mcmc_hist_init(&alloc_latency[order]);
+        mcmc_hist_init(&free_latency[order]);
+        for (int w = 0; w < MCMC_WORKERS; ++w)
+        {
+            mcmc_hist_merge(&alloc_latency[order], &mcmc_ctx[w].alloc_latency[order]);
+            mcmc_hist_merge(&free_latency[order], &mcmc_ctx[w].free_latency[order]);
+        }
+    }
+    printf("\n*********** Latency (cycles) ***********\n\n");
+    for (int order = 0; order <= MCMC_MAX_ORDER; ++order)
+    {
+        mcmc_latency_print_one("alloc", order, &alloc_latency[order]);
+    }
+    for (int order = 0; order <= MCMC_MAX_ORDER; ++order)
+    {
+        mcmc_latency_print_one("free", order, &free_latency[order]);
+    }
+}
+#else
+#define MCMC_LATENCY_START(start, hist)
+#define MCMC_LATENCY_END(start)
+#endif
+
+#ifdef CONFIG_MRMC_SAMPLER
+/***
+ * Footprint and fragmentation over time: every MRMCSampleInterval iterations
+ * (after the frees of that iteration) the number of outstanding units and
+ * the frames held by their blocks are sampled, and with MRMCSampleProbe the
+ * largest allocatable order, see mcmc_largest_order. Probing is kept out of
+ * the latency histograms, and its cycles out of the TCB utilisation and the
+ * cycles of the run, see mcmc_probe_order.
+ */
+static mcmc_sampler_t mcmc_sampler;
+
+static void mcmc_sampler_reserve(int iterations)
+{
+    size_t capacity = iterations / CONFIG_MRMC_SAMPLE_INTERVAL + 1;
+
+    mcmc_sampler_init(&mcmc_sampler, (mcmc_sample_t *)mcmc_pages_reserve(capacity * sizeof(mcmc_sample_t)),
+                      capacity, CONFIG_MRMC_SAMPLE_INTERVAL);
+}
+
+static void mcmc_sample(mcmc_ctx_t *ctx UNUSED, vka_t *vka UNUSED, int i, size_t live_units, size_t live_frames)
+{
+    mcmc_sample_t *sample = mcmc_sampler_next(&mcmc_sampler);
+
+    sample->iteration = i;
+    sample->live_units = live_units;
+    sample->live_frames = live_frames;
+#ifdef CONFIG_MRMC_METADATA_REPORT
+    sample->metadata_bytes = mcmc_metadata_bytes;
+#else
+    sample->metadata_bytes = MCMC_SAMPLE_NO_METADATA;
+#endif
+#ifdef CONFIG_MRMC_SAMPLE_PROBE
+    sample->largest_order = mcmc_probe_order(ctx, vka);
+#else
+    sample->largest_order = MCMC_SAMPLE_NO_PROBE;
+#endif
+}
+
+static void mcmc_sampler_report(void)
+{
+    mrmc_Record record = mrmc_Record_init_zero;
+    size_t count = mcmc_sampler_count(&mcmc_sampler);
+
+    printf("[SAMPLE]: %zu samples (every %u iterations)\n", count, mcmc_sampler.interval);
+    record.which_payload = mrmc_Record_sample_tag;
+    for (size_t s = 0; s < count; ++s)
+    {
+        const mcmc_sample_t *sample = mcmc_sampler_get(&mcmc_sampler, s);
+
+        record.payload.sample.iteration = sample->iteration;
+        record.payload.sample.live_units = sample->live_units;
+        record.payload.sample.live_frames = sample->live_frames;
+        record.payload.sample.has_largest_order = sample->largest_order != MCMC_SAMPLE_NO_PROBE;
+        record.payload.sample.largest_order = sample->largest_order;
+        record.payload.sample.has_metadata_bytes = sample->metadata_bytes != MCMC_SAMPLE_NO_METADATA;
+        record.payload.sample.metadata_bytes = sample->metadata_bytes;
+        mcmc_result_append(&record);
+    }
+}
+#endif
+
+#if (ENABLE_CAPBUDDY_EXTENSION)
+#define MCMC_ALLOCATOR_NAME "capbuddy"
+#elif defined(CONFIG_MRMC_BULK_RETYPE)
+#define MCMC_ALLOCATOR_NAME "cascading-bulk"
+#else
+#define MCMC_ALLOCATOR_NAME "cascading"
+#endif
+
+/* Bytes reserved for the encoded records of one run, on top of the samples */
+#define MCMC_RESULT_BUFFER_SIZE (1ul << (seL4_PageBits + 4))
+/* Upper bound of one encoded and delimited sample record */
+#define MCMC_SAMPLE_RECORD_SIZE 64
+/* Upper bound of one encoded and delimited worker record */
+#define MCMC_WORKER_RECORD_SIZE 80
+/* Upper bound of one encoded and delimited kernel entry record */
+#define MCMC_KERNEL_ENTRY_RECORD_SIZE 80
+/* Upper bound of one encoded and delimited object kind record */
+#define MCMC_OBJECT_RECORD_SIZE 96
+/* Upper bound of one encoded and delimited client record */
+#define MCMC_CLIENT_RECORD_SIZE 176
+
+#ifdef CONFIG_MRMC_CAPACITY_SEARCH
+/**
+ * Load of the random requests at 'free_frequency': the mean lifetime
+ * (free_frequency / 2 iterations) times the mean size, which is the number
+ * of frames outstanding on average with one request per iteration.
+ */
+static uint64_t mcmc_capacity_load(uint32_t free_frequency)
+{
+    return (free_frequency * mcmc_dist_mean(&mcmc_size_dist)) >> (MCMC_DIST_MEAN_SHIFT + 1);
+}
+#endif
+
+#ifdef CONFIG_MRMC_CALIBRATE
+/**
+ * Cycles of the null backend run, which all go to the driver. Without TCB
+ * utilisation, they are the cycles the run took (with MRMCSmpWorkers, the
+ * ones every worker took on its own core, summed, just as TCB utilisation
+ * is), and the kernel cycles of the allocator cannot be told apart from
+ * its user-level ones.
+ */
+static struct {
+    bool valid;
+    uint64_t cycles;
+    uint64_t kernel_cycles;
+} mcmc_driver;
+
+#ifdef MCMC_TRACK_UTILISATION
+#define MCMC_CALIBRATION_CYCLES(result) ((result)->tcb_cycles)
+#elif defined(CONFIG_MRMC_SMP_WORKERS)
+#define MCMC_CALIBRATION_CYCLES(result) ((result)->worker_cycles)
+#else
+#define MCMC_CALIBRATION_CYCLES(result) ((result)->cycles)
+#endif
+
+/**
+ * Split the cycles of an allocator run into the ones of the driver, of
+ * the allocator at user level and of the kernel on its behalf. Noise may
+ * leave the latter two slightly negative.
+ */
+static void mcmc_calibration_report(const mcmc_result_t *result, mrmc_RunResult *run)
+{
+    int64_t kernel = 0;
+
+    if (mcmc_null_backend || !mcmc_driver.valid) {
+        return;
+    }
+#ifdef MCMC_TRACK_UTILISATION
+    kernel = (int64_t)(result->kernel_cycles - mcmc_driver.kernel_cycles);
+    run->has_allocator_kernel_cycles = true;
+    run->allocator_kernel_cycles = kernel;
+#endif
+    int64_t allocator = (int64_t)(MCMC_CALIBRATION_CYCLES(result) - mcmc_driver.cycles) - kernel;
+
+    run->has_driver_cycles = true;
+    run->driver_cycles = mcmc_driver.cycles;
+    run->has_allocator_cycles = true;
+    run->allocator_cycles = allocator;
+#ifdef MCMC_TRACK_UTILISATION
+    printf("[CALIBRATE]: driver %" PRIu64 " allocator %" PRId64 " kernel %" PRId64 " cycles\n",
+           mcmc_driver.cycles, allocator, kernel);
+#else
+    printf("[CALIBRATE]: driver %" PRIu64 " allocator and kernel %" PRId64 " cycles\n",
+           mcmc_driver.cycles, allocator);
+#endif
+}
+#endif
+
+/**
+ * Report a run on the console and into the result stream. 'tcb_cycles'
+ * and 'kernel_cycles' are only valid if 'have_cycles' is set.
+ */
+static void mcmc_result_report(const mcmc_result_t *result, bool have_cycles,
+                               uint64_t tcb_cycles, uint64_t kernel_cycles)
+{
+    mrmc_Record record = mrmc_Record_init_zero;
+    mrmc_RunResult *run = &record.payload.run;
+
+    printf("[DONE]: total %zu iteration %d\n", result->total_frames, result->iterations);
+    if (result->error != seL4_NoError) {
+        printf("[DONE]: allocation failed with error %d\n", result->error);
+    }
+#ifdef MCMC_COUNT_FAILURES
+    if (result->failures) {
+        printf("[DONE]: %zu of %zu requests failed, the first at iteration %d\n",
+               result->failures, result->requests + result->failures, result->first_failure);
+    }
+#endif
+    record.which_payload = mrmc_Record_run_tag;
+#ifdef CONFIG_MRMC_CALIBRATE
+    strncpy(run->allocator, mcmc_null_backend ? "null" : MCMC_ALLOCATOR_NAME, sizeof(run->allocator) - 1);
+#else
+    strncpy(run->allocator, MCMC_ALLOCATOR_NAME, sizeof(run->allocator) - 1);
+#endif
+    run->iterations = result->iterations;
+    run->requests = result->requests;
+    run->total_frames = result->total_frames;
+    run->error = result->error;
+    run->has_workers = true;
+    run->workers = MCMC_WORKERS;
+    run->has_seed = true;
+    run->seed = mcmc_params.seed;
+#ifndef CONFIG_MRMC_TRACE_REPLAY
+    run->has_policy = true;
+    strncpy(run->policy, mcmc_policy_names[mcmc_params.policy], sizeof(run->policy) - 1);
+    run->has_free_frequency = true;
+    run->free_frequency = mcmc_params.free_frequency;
+#endif
+#ifdef MCMC_MULTI_RUN
+    run->has_clean = true;
+    run->clean = result->clean;
+#endif
+#ifdef CONFIG_MRMC_MAGAZINE
+    run->has_magazine_hits = true;
+    run->magazine_hits = result->magazine_hits;
+    run->has_magazine_misses = true;
+    run->magazine_misses = result->magazine_misses;
+    run->has_magazine_drained = true;
+    run->magazine_drained = result->magazine_drained;
+#endif
+#ifdef MCMC_COUNT_FAILURES
+    run->has_failures = true;
+    run->failures = result->failures;
+    run->has_first_failure = result->failures != 0;
+    run->first_failure = result->first_failure;
+#endif
+#ifdef CONFIG_MRMC_CAPACITY_SEARCH
+    run->has_load = true;
+    run->load = mcmc_capacity_load(mcmc_params.free_frequency);
+#endif
+    run->has_peak_footprint = true;
+    run->peak_footprint = result->peak_footprint;
+#ifndef CONFIG_MRMC_MEMORY_SERVER
+    /* The server does not see the iterations of its clients */
+    run->has_mean_footprint = true;
+    run->mean_footprint = result->iterations ? result->footprint_sum / result->iterations : 0;
+#endif
+    run->has_peak_units = true;
+    run->peak_units = result->peak_units;
+#ifdef CONFIG_MRMC_FREE_EPOCH
+    run->has_free_epoch = true;
+    run->free_epoch = CONFIG_MRMC_FREE_EPOCH_LENGTH;
+    run->has_epochs = true;
+    run->epochs = result->epochs;
+    run->has_max_epoch_units = true;
+    run->max_epoch_units = result->max_epoch_units;
+    run->has_epoch_order_min = result->epochs != 0;
+    run->epoch_order_min = result->epoch_order_min;
+    run->has_epoch_order_sum = true;
+    run->epoch_order_sum = result->epoch_order_sum;
+#endif
+#ifdef MCMC_PROBE_CYCLES
+    run->has_probe_cycles = true;
+    run->probe_cycles = result->probe_cycles;
+    run->has_probe_kernel_cycles = true;
+    run->probe_kernel_cycles = result->probe_kernel_cycles;
+#endif
+#ifdef CONFIG_MRMC_METADATA_REPORT
+    run->has_metadata_bytes_start = true;
+    run->metadata_bytes_start = result->metadata_start;
+    run->has_metadata_bytes_peak = true;
+    run->metadata_bytes_peak = result->metadata_peak;
+#endif
+#ifdef CONFIG_MRMC_MAP_TOUCH
+    run->has_mapped_pages = true;
+    run->mapped_pages = result->mapped_pages;
+    run->has_mapped_large_pages = true;
+    run->mapped_large_pages = result->mapped_large_pages;
+    run->has_large_page_cycles = true;
+    run->large_page_cycles = result->large_page_cycles;
+    run->has_map_cycles = true;
+    run->map_cycles = result->map_cycles;
+    run->has_unmap_cycles = true;
+    run->unmap_cycles = result->unmap_cycles;
+    run->has_paging_objects = true;
+    run->paging_objects = result->paging_objects;
+#endif
+#ifdef MCMC_RUN_CYCLES
+    run->has_cycles = true;
+    run->cycles = result->cycles;
+#endif
+#ifdef CONFIG_MRMC_CALIBRATE
+    mcmc_calibration_report(result, run);
+#endif
+#ifdef MCMC_OP_CYCLES
+    run->has_alloc_cycles = true;
+    run->alloc_cycles = result->alloc_cycles;
+    run->has_free_cycles = true;
+    run->free_cycles = result->free_cycles;
+    run->has_frees = true;
+    run->frees = result->frees;
+#endif
+#ifdef CONFIG_MRMC_MEMORY_SERVER
+    run->has_clients = true;
+    run->clients = CONFIG_MRMC_SERVER_CLIENTS;
+    run->has_batch_size = true;
+    run->batch_size = CONFIG_MRMC_SERVER_BATCH;
+    run->has_batches = true;
+    run->batches = result->batches;
+    run->has_round_trip_cycles = true;
+    run->round_trip_cycles = result->round_trip_cycles;
+#endif
+#ifdef CONFIG_MRMC_KERNEL_ENTRIES
+    run->has_kernel_log_entries = true;
+    run->kernel_log_entries = result->kernel_log_entries;
+    run->has_kernel_log_full = true;
+    run->kernel_log_full = result->kernel_log_entries >= MCMC_KERNEL_LOG_ENTRIES;
+#endif
+    run->has_tcb_cycles = have_cycles;
+    run->tcb_cycles = tcb_cycles;
+    run->has_kernel_cycles = have_cycles;
+    run->kernel_cycles = kernel_cycles;
+    mcmc_result_append(&record);
+}
+
+/**
+ * Fetch the next memory request of iteration 'i' of a worker into 'req'.
+ * With MRMCTraceReplay, every worker replays the whole trace.
+ *
+ * @return false once iteration 'i' has no more requests.
+ */
+static inline bool mcmc_request_next(mcmc_ctx_t *ctx, int i, mcmc_trace_record_t *req)
+{
+#ifdef CONFIG_MRMC_TRACE_REPLAY
+    const mcmc_trace_record_t *record = &mcmc_trace_records(mcmc_trace)[ctx->cursor];
+
+    if (ctx->cursor == mcmc_trace->records || record->iteration != i) {
+        return false;
+    }
+    *req = *record;
+    ctx->cursor++;
+    return true;
+#else
+    /* Exactly one random request per iteration */
+    if (ctx->cursor == i) {
+        return false;
+    }
+    ctx->cursor = i;
+#ifdef CONFIG_MRMC_SCHEDULE
+    mcmc_schedule_unpack(ctx->schedule[i - 1], i, req);
+#else
+    mcmc_workload_draw(&ctx->rng, &mcmc_size_dist, mcmc_params.free_frequency, i, req);
+#endif
+#ifdef CONFIG_MRMC_TRACE_CAPTURE
+    mcmc_capture[mcmc_capture_count++] = *req;
+#endif
+    return true;
+#endif
+}
+
+#ifdef MCMC_OP_CYCLES
+/* Account one allocation of a request of 'kind', failed or not, which took 'cycles' */
+static inline void mcmc_op_alloc_cycles(mcmc_ctx_t *ctx, int kind UNUSED, uint64_t cycles)
+{
+    ctx->result.alloc_cycles += cycles;
+#ifdef CONFIG_MRMC_OBJECT_MIX
+    mcmc_object_stats_t *stats = &ctx->result.objects[kind];
+
+    stats->allocs++;
+    stats->alloc_cycles += cycles;
+    stats->alloc_max = MAX(stats->alloc_max, cycles);
+#endif
+}
+
+/* Account one free of a unit of 'kind', which took 'cycles' */
+static inline void mcmc_op_free_cycles(mcmc_ctx_t *ctx, int kind UNUSED, uint64_t cycles)
+{
+    ctx->result.free_cycles += cycles;
+    ctx->result.frees++;
+#ifdef CONFIG_MRMC_OBJECT_MIX
+    mcmc_object_stats_t *stats = &ctx->result.objects[kind];
+
+    stats->frees++;
+    stats->free_cycles += cycles;
+    stats->free_max = MAX(stats->free_max, cycles);
+#endif
+}
+#endif
+
+/* Give a memory unit and its bookkeeping back for good */
+static void mcmc_memory_unit_release(mcmc_ctx_t *ctx, vka_t *vka, mcmc_memory_unit_t *unit)
+{
+    mcmc_vka_lock();
+#ifdef CONFIG_MRMC_OBJECT_MIX
+    if (unit->kind != MCMC_OBJECT_FRAMES) {
+        vka_free_object(vka, &unit->object);
+    } else {
+        mcmc_backend_free(ctx, vka, unit);
+    }
+#else
+    mcmc_backend_free(ctx, vka, unit);
+#endif
+    mcmc_vka_unlock();
+    mcmc_slab_free(&ctx->unit_slab, unit);
+}
+
+#ifdef CONFIG_MRMC_MAGAZINE
+/***
+ * Magazines: every worker keeps up to MRMCMagazineSize recently freed units
+ * of every order, along with their caps (and, for the cascading allocator,
+ * their retyped frames), and hands them out again to later requests of the
+ * same order. vka_alloc_frame_contiguous retypes a whole CapBuddy block
+ * whatever the request, so such a block goes out as it is, without going
+ * through vka at all. The cascading allocator only retypes as many frames
+ * as requested, so a unit of the same order with another frame count is
+ * retyped afresh, see mcmc_memory_unit_reuse. A full magazine drains its
+ * older half back to vka before it takes the next unit, and whatever is
+ * left is given back after the run by mcmc_magazine_flush.
+ */
+static mcmc_memory_unit_t *mcmc_magazine_pop(mcmc_ctx_t *ctx, int order)
+{
+    if (ctx->magazine_top[order] == 0) {
+        ctx->result.magazine_misses++;
+        return NULL;
+    }
+    ctx->result.magazine_hits++;
+    return ctx->magazine[order][--ctx->magazine_top[order]];
+}
+
+static void mcmc_magazine_push(mcmc_ctx_t *ctx, vka_t *vka, mcmc_memory_unit_t *unit)
+{
+    int order = mcmc_memory_unit_order(unit);
+    mcmc_memory_unit_t **magazine = ctx->magazine[order];
+
+    if (ctx->magazine_top[order] == CONFIG_MRMC_MAGAZINE_SIZE) {
+        size_t drain = (CONFIG_MRMC_MAGAZINE_SIZE + 1) / 2;
+
+        for (size_t m = 0; m < drain; ++m)
+        {
+            mcmc_memory_unit_release(ctx, vka, magazine[m]);
+        }
+        memmove(magazine, magazine + drain, (CONFIG_MRMC_MAGAZINE_SIZE - drain) * sizeof(*magazine));
+        ctx->magazine_top[order] -= drain;
+        ctx->result.magazine_drained += drain;
+    }
+    magazine[ctx->magazine_top[order]++] = unit;
+}
+
+static void mcmc_magazine_flush(mcmc_ctx_t *ctx, vka_t *vka)
+{
+    for (int order = 0; order <= MCMC_MAX_ORDER; ++order)
+    {
+        while (ctx->magazine_top[order])
+        {
+            mcmc_memory_unit_release(ctx, vka, ctx->magazine[order][--ctx->magazine_top[order]]);
+        }
+    }
+}
+#endif
+
+/* The in-process driver, MRMCMemoryServer leaves the driving to its clients */
+#ifndef CONFIG_MRMC_MEMORY_SERVER
+/**
+ * Free an expired memory unit (into the magazine, with MRMCMagazine).
+ *
+ * @return the number of frames its block held.
+ */
+static size_t mcmc_memory_unit_expire(mcmc_ctx_t *ctx, vka_t *vka, mcmc_memory_unit_t *tx)
+{
+#ifdef CONFIG_MRMC_OBJECT_MIX
+    if (tx->kind != MCMC_OBJECT_FRAMES) {
+        int kind = tx->kind;
+        ccnt_t start = sel4bench_get_cycle_count();
+
+        mcmc_memory_unit_release(ctx, vka, tx);
+        mcmc_op_free_cycles(ctx, kind, sel4bench_get_cycle_count() - start);
+        return 0;
+    }
+#endif
+    int order = mcmc_memory_unit_order(tx);
+
+#ifdef CONFIG_MRMC_MAP_TOUCH
+    mcmc_memory_unit_unmap(ctx, vka, tx);
+#endif
+    MCMC_LATENCY_START(tf_start, &ctx->free_latency[order]);
+#ifdef MCMC_OP_CYCLES
+    ccnt_t op_start = sel4bench_get_cycle_count();
+#endif
+#ifdef CONFIG_MRMC_MAGAZINE
+    mcmc_magazine_push(ctx, vka, tx);
+#else
+    mcmc_memory_unit_release(ctx, vka, tx);
+#endif
+#ifdef MCMC_OP_CYCLES
+    mcmc_op_free_cycles(ctx, MCMC_OBJECT_FRAMES, sel4bench_get_cycle_count() - op_start);
+#endif
+    MCMC_LATENCY_END(tf_start);
+    return BIT(order);
+}
+
+#ifdef CONFIG_MRMC_FREE_EPOCH
+/***
+ * Free epochs: expired units are not freed in the iteration they expire at,
+ * but queued by the driver until the end of the epoch (every
+ * MRMCFreeEpochLength iterations), and then freed back to back in one
+ * batch. Queued units still hold their blocks, so they count towards the
+ * footprint, and the free latency histograms time every unit of a batch on
+ * its own.
+ */
+/**
+ * Most units (and frames) queued at the same time: a whole epoch worth of
+ * requests, on top of the units which are still outstanding.
+ */
+static void mcmc_epoch_slack(size_t *units, size_t *frames)
+{
+#ifdef CONFIG_MRMC_TRACE_REPLAY
+    const mcmc_trace_record_t *records = mcmc_trace_records(mcmc_trace);
+    size_t window_units = 0;
+    size_t window_frames = 0;
+    size_t max_units = 0;
+    size_t max_frames = 0;
+    size_t first = 0;
+
+    /* Largest number of requests (and frames) within any epoch worth of iterations */
+    for (size_t last = 0; last < mcmc_trace->records; ++last)
+    {
+        window_units++;
+        window_frames += records[last].frames;
+        while (records[last].iteration - records[first].iteration >= CONFIG_MRMC_FREE_EPOCH_LENGTH)
+        {
+            window_units--;
+            window_frames -= records[first++].frames;
+        }
+        max_units = MAX(max_units, window_units);
+        max_frames = MAX(max_frames, window_frames);
+    }
+    *units += max_units;
+    *frames += max_frames;
+#else
+    /* Exactly one request per iteration */
+    *units += CONFIG_MRMC_FREE_EPOCH_LENGTH;
+    *frames += CONFIG_MRMC_FREE_EPOCH_LENGTH * MCMC_MAX_FRAME_COUNT;
+#endif
+}
+#endif
+
+/**
+ * Allocate one memory unit of 'frame_count' frames at iteration 'i' into
+ * '*unit', whose expiry the driver schedules.
+ */
+static int mcmc_request_alloc(mcmc_ctx_t *ctx, vka_t *vka, int i, uint32_t frame_count, mcmc_memory_unit_t **unit)
+{
+    mcmc_memory_unit_t *tx = NULL;
+    int mcmc_errno;
+    int order = mcmc_frame_order(frame_count);
+    bool cached;
+
+#ifdef CONFIG_MRMC_MAGAZINE
+    tx = mcmc_magazine_pop(ctx, order);
+#endif
+    cached = tx != NULL;
+    /**
+     * new memory unit metadata initialization:
+    */
+    if (!cached) {
+        tx = (mcmc_memory_unit_t *)mcmc_slab_alloc(&ctx->unit_slab);
+        if (tx == NULL) {
+            /* memory unit arena exhausted */
+            return seL4_NotEnoughMemory;
+        }
+    }
+    tx->iter_stamp = i;
+#ifdef CONFIG_MRMC_OBJECT_MIX
+    tx->kind = MCMC_OBJECT_FRAMES;
+#endif
+
+    MCMC_LATENCY_START(ta_start, &ctx->alloc_latency[order]);
+#ifdef MCMC_OP_CYCLES
+    ccnt_t op_start = sel4bench_get_cycle_count();
+#endif
+#if defined(CONFIG_MRMC_MAGAZINE) && !(ENABLE_CAPBUDDY_EXTENSION)
+    mcmc_vka_lock();
+    if (cached) {
+        mcmc_errno = mcmc_memory_unit_reuse(ctx, vka, tx, frame_count);
+    } else {
+        mcmc_errno = mcmc_backend_alloc(ctx, vka, tx, frame_count);
+    }
+    mcmc_vka_unlock();
+#else
+    /* A CapBuddy block is retyped whole, so one from the magazine is handed out as it is */
+    mcmc_errno = seL4_NoError;
+    if (!cached) {
+        mcmc_vka_lock();
+        mcmc_errno = mcmc_backend_alloc(ctx, vka, tx, frame_count);
+        mcmc_vka_unlock();
+    }
+#endif
+#ifdef MCMC_OP_CYCLES
+    mcmc_op_alloc_cycles(ctx, MCMC_OBJECT_FRAMES, sel4bench_get_cycle_count() - op_start);
+#endif
+    MCMC_LATENCY_END(ta_start);
+    if (mcmc_errno) {
+        mcmc_slab_free(&ctx->unit_slab, tx);
+        return mcmc_errno;
+    }
+#ifdef CONFIG_MRMC_MAP_TOUCH
+    mcmc_errno = mcmc_memory_unit_map(ctx, vka, tx, frame_count);
+    if (mcmc_errno) {
+        mcmc_memory_unit_release(ctx, vka, tx);
+        return mcmc_errno;
+    }
+#endif
+    *unit = tx;
+    return seL4_NoError;
+}
+
+#ifdef CONFIG_MRMC_OBJECT_MIX
+/***
+ * Object mix: every request draws its kind from MRMCObjectMixTable after
+ * its size and expiry. Frames requests are memory units as without the
+ * mix, every other kind is a single kernel object allocated through
+ * vka_alloc_object, held in a unit of its own in the expiry wheel, and
+ * freed at its expiry just like memory units are. Kernel objects are not
+ * part of the footprint, which stays in frames of memory unit blocks.
+ */
+static seL4_Word mcmc_object_type(int kind, uint32_t radix, seL4_Word *size_bits)
+{
+    switch (kind) {
+    case MCMC_OBJECT_TCB:
+        *size_bits = seL4_TCBBits;
+        return kobject_get_type(KOBJECT_TCB, 0);
+    case MCMC_OBJECT_ENDPOINT:
+        *size_bits = seL4_EndpointBits;
+        return kobject_get_type(KOBJECT_ENDPOINT, 0);
+    case MCMC_OBJECT_NOTIFICATION:
+        *size_bits = seL4_NotificationBits;
+        return kobject_get_type(KOBJECT_NOTIFICATION, 0);
+    case MCMC_OBJECT_CNODE:
+        /* The size of a CNode is its radix, as for vka_alloc_cnode_object */
+        *size_bits = radix;
+        return kobject_get_type(KOBJECT_CNODE, 0);
+    case MCMC_OBJECT_PAGE_TABLE:
+        *size_bits = seL4_PageTableBits;
+        return kobject_get_type(KOBJECT_PAGE_TABLE, 0);
+    default:
+        *size_bits = seL4_LargePageBits;
+        return kobject_get_type(KOBJECT_FRAME, seL4_LargePageBits);
+    }
+}
+
+/**
+ * Allocate one kernel object of 'kind' ('radix' for a CNode) at iteration
+ * 'i' into the unit '*unit', whose expiry the driver schedules.
+ */
+static int mcmc_object_request(mcmc_ctx_t *ctx, vka_t *vka, int i, int kind, uint32_t radix,
+                               mcmc_memory_unit_t **unit)
+{
+    seL4_Word size_bits;
+    seL4_Word type = mcmc_object_type(kind, radix, &size_bits);
+
+    mcmc_memory_unit_t *tx = (mcmc_memory_unit_t *)mcmc_slab_alloc(&ctx->unit_slab);
+    if (tx == NULL) {
+        return seL4_NotEnoughMemory;
+    }
+    tx->iter_stamp = i;
+    tx->kind = kind;
+
+    ccnt_t start = sel4bench_get_cycle_count();
+    mcmc_vka_lock();
+    int err = vka_alloc_object(vka, type, size_bits, &tx->object);
+    mcmc_vka_unlock();
+    mcmc_op_alloc_cycles(ctx, kind, sel4bench_get_cycle_count() - start);
+    if (err) {
+        mcmc_slab_free(&ctx->unit_slab, tx);
+        return err;
+    }
+    *unit = tx;
+    return seL4_NoError;
+}
+
+/* Print the kinds of the mix, and put them into the result stream */
+static void mcmc_object_report(const mcmc_result_t *result)
+{
+    mrmc_Record record = mrmc_Record_init_zero;
+    mrmc_ObjectKind *object = &record.payload.object_kind;
+
+    record.which_payload = mrmc_Record_object_kind_tag;
+    for (int kind = 0; kind < MCMC_OBJECTS; ++kind)
+    {
+        const mcmc_object_stats_t *stats = &result->objects[kind];
+
+        if (stats->allocs == 0) {
+            continue;
+        }
+        printf("[OBJECT %s]: allocs %zu frees %zu, cycles per alloc %" PRIu64 " (max %" PRIu64 ")"
+               " per free %" PRIu64 " (max %" PRIu64 "), allocs/Mcycle %" PRIu64 "\n",
+               mcmc_object_names[kind], stats->allocs, stats->frees, stats->alloc_cycles / stats->allocs,
+               stats->alloc_max, stats->frees ? stats->free_cycles / stats->frees : 0, stats->free_max,
+               stats->alloc_cycles ? stats->allocs * 1000000 / stats->alloc_cycles : 0);
+        memset(object, 0, sizeof(*object));
+        strncpy(object->kind, mcmc_object_names[kind], sizeof(object->kind) - 1);
+        object->allocs = stats->allocs;
+        object->frees = stats->frees;
+        object->alloc_cycles = stats->alloc_cycles;
+        object->free_cycles = stats->free_cycles;
+        object->alloc_max = stats->alloc_max;
+        object->free_max = stats->free_max;
+        mcmc_result_append(&record);
+    }
+}
+#endif
+
+/***
+ * Callbacks of the driver loop (see mcmc/driver.h), which the native host
+ * build runs against its allocator models just the same.
+ */
+static bool mcmc_driver_next(void *cookie, uint32_t i, mcmc_trace_record_t *req)
+{
+    return mcmc_request_next((mcmc_ctx_t *)cookie, i, req);
+}
+
+static int mcmc_driver_alloc(void *cookie, uint32_t i, const mcmc_trace_record_t *req,
+                             mcmc_wheel_node_t **node, size_t *frames)
+{
+    mcmc_ctx_t *ctx = (mcmc_ctx_t *)cookie;
+    mcmc_memory_unit_t *tx;
+    int mcmc_errno;
+
+#ifdef CONFIG_MRMC_OBJECT_MIX
+    /* One request per iteration, so as 'i' picks its kind */
+#ifdef CONFIG_MRMC_SCHEDULE
+    mcmc_object_t object = mcmc_schedule_object(ctx->schedule[i - 1]);
+#else
+    mcmc_object_t object = ctx->objects[i - 1];
+#endif
+    int kind = mcmc_object_kind(object);
+
+    if (kind != MCMC_OBJECT_FRAMES) {
+        mcmc_errno = mcmc_object_request(ctx, &env.vka, i, kind, mcmc_object_radix(object), &tx);
+        /* No frames of the footprint, see mcmc_object_request */
+        *frames = 0;
+        *node = mcmc_errno ? NULL : &tx->node;
+        return mcmc_errno;
+    }
+#endif
+    mcmc_errno = mcmc_request_alloc(ctx, &env.vka, i, req->frames, &tx);
+    *frames = BIT(mcmc_frame_order(req->frames));
+    *node = mcmc_errno ? NULL : &tx->node;
+    return mcmc_errno;
+}
+
+static size_t mcmc_driver_expire(void *cookie, mcmc_wheel_node_t *node)
+{
+    return mcmc_memory_unit_expire((mcmc_ctx_t *)cookie, &env.vka, mcmc_memory_unit_of(node));
+}
+
+#ifdef CONFIG_MRMC_SAMPLER
+static void mcmc_driver_sample(void *cookie, uint32_t i, size_t units, size_t frames)
+{
+    if (mcmc_sampler_due(&mcmc_sampler, i)) {
+        mcmc_sample((mcmc_ctx_t *)cookie, &env.vka, i, units, frames);
+    }
+}
+#endif
+
+#ifdef CONFIG_MRMC_FREE_EPOCH
+#define MCMC_FREE_EPOCH_LENGTH CONFIG_MRMC_FREE_EPOCH_LENGTH
+
+/**
+ * How well a batch coalesced: the largest order allocatable right after
+ * it is freed, as the frees of a batch are meant to merge buddies which
+ * freeing them one at a time would have split again in between.
+ */
+static void mcmc_driver_epoch(void *cookie, uint32_t i UNUSED)
+{
+    mcmc_ctx_t *ctx = (mcmc_ctx_t *)cookie;
+    int order = mcmc_probe_order(ctx, &env.vka);
+
+    /* The batch is counted already */
+    if (ctx->driver.stats.epochs == 1 || order < ctx->result.epoch_order_min) {
+        ctx->result.epoch_order_min = order;
+    }
+    ctx->result.epoch_order_sum += order;
+}
+#else
+#define MCMC_FREE_EPOCH_LENGTH 0
+#endif
+
+static const mcmc_driver_ops_t mcmc_driver_ops = {
+    .next = mcmc_driver_next,
+    .alloc = mcmc_driver_alloc,
+    .expire = mcmc_driver_expire,
+#ifdef CONFIG_MRMC_SAMPLER
+    .sample = mcmc_driver_sample,
+#endif
+#ifdef CONFIG_MRMC_FREE_EPOCH
+    .epoch = mcmc_driver_epoch,
+#endif
+};
+
+static int mcmc_exp_simulation(mcmc_ctx_t *ctx)
+{
+    const mcmc_driver_stats_t *stats = &ctx->driver.stats;
+    int iterations = mcmc_params.iterations;
+    int mcmc_errno;
+
+#ifdef CONFIG_MRMC_TRACE_REPLAY
+    iterations = mcmc_trace->iterations;
+#endif
+    mcmc_errno = mcmc_driver_run(&ctx->driver, iterations);
+
+    ctx->result.iterations = stats->iterations;
+    ctx->result.requests = stats->requests;
+    ctx->result.total_frames = stats->total_frames;
+    ctx->result.error = stats->error;
+    ctx->result.peak_footprint = stats->peak_footprint;
+    ctx->result.footprint_sum = stats->footprint_sum;
+    ctx->result.peak_units = stats->peak_units;
+    ctx->result.epochs = stats->epochs;
+    ctx->result.max_epoch_units = stats->max_epoch_units;
+    ctx->result.failures = stats->failures;
+    ctx->result.first_failure = stats->first_failure;
+    return mcmc_errno;
+}
+#endif
+
+#ifdef CONFIG_MRMC_SMP_WORKERS
+/***
+ * SMP mode: one worker thread per core, pinned to it, and each of them runs
+ * the whole simulation on its own request stream, expiry wheel and arenas.
+ * The workers are created before the timed region and spin until the
+ * initial thread has reset the benchmark counters and moved on to the next
+ * run, then it blocks until all of them are done. Between runs the workers
+ * block on a notification of their own, which latches the wakeup for the
+ * next run even if it comes before they wait on it.
+ */
+static int mcmc_smp_run;
+static int mcmc_smp_done;
+static vka_object_t mcmc_smp_done_ntfn;
+
+static void mcmc_worker_entry(void *arg0, void *arg1 UNUSED, void *ipc_buf UNUSED)
+{
+    mcmc_ctx_t *ctx = (mcmc_ctx_t *)arg0;
+
+#ifdef MCMC_READS_CYCLES
+    /* The initial thread only set up the counter of its own core */
+    sel4bench_init();
+#endif
+    for (int run = 1;; ++run)
+    {
+        while (__atomic_load_n(&mcmc_smp_run, __ATOMIC_ACQUIRE) != run);
+#ifdef CONFIG_MRMC_CALIBRATE
+        ccnt_t start = sel4bench_get_cycle_count();
+        mcmc_exp_simulation(ctx);
+        ctx->result.worker_cycles = sel4bench_get_cycle_count() - start - ctx->result.probe_cycles;
+#else
+        mcmc_exp_simulation(ctx);
+#endif
+        __atomic_fetch_add(&mcmc_smp_done, 1, __ATOMIC_RELEASE);
+        seL4_Signal(mcmc_smp_done_ntfn.cptr);
+        /* Stay around without spinning, the utilisation of this TCB is read after the run */
+        seL4_Wait(ctx->wake_ntfn.cptr, NULL);
+    }
+}
+
+static void mcmc_worker_pin(mcmc_ctx_t *ctx)
+{
+    int err;
+#ifdef CONFIG_KERNEL_MCS
+    seL4_Time timeslice = CONFIG_BOOT_THREAD_TIME_SLICE * US_IN_MS;
+
+    err = seL4_SchedControl_ConfigureFlags(simple_get_sched_ctrl(&env.simple, ctx->core),
+                                           ctx->thread.sched_context.cptr,
+                                           timeslice, timeslice, 0, 0, seL4_SchedContext_NoFlag);
+#else
+    err = seL4_TCB_SetAffinity(ctx->thread.tcb.cptr, ctx->core);
+#endif
+    if (err) {
+        ZF_LOGF("Failed to pin worker to core %d", ctx->core);
+    }
+}
+
+static void mcmc_workers_start(void)
+{
+    int err = vka_alloc_notification(&env.vka, &mcmc_smp_done_ntfn);
+    if (err) {
+        ZF_LOGF("Failed to allocate notification for workers");
+    }
+    for (int w = 0; w < MCMC_WORKERS; ++w)
+    {
+        mcmc_ctx_t *ctx = &mcmc_ctx[w];
+
+        err = vka_alloc_notification(&env.vka, &ctx->wake_ntfn);
+        if (err) {
+            ZF_LOGF("Failed to allocate notification for worker %d", w);
+        }
+        /* Below the initial thread, so as it is never held up by the worker on its core */
+        sel4utils_thread_config_t config = thread_config_default(&env.simple, simple_get_cnode(&env.simple),
+                                                                 seL4_NilData, seL4_CapNull, seL4_MaxPrio - 1);
+
+        err = sel4utils_configure_thread_config(&env.vka, &env.vspace, &env.vspace, config, &ctx->thread);
+        if (err) {
+            ZF_LOGF("Failed to configure worker %d", w);
+        }
+        mcmc_worker_pin(ctx);
+        err = sel4utils_start_thread(&ctx->thread, mcmc_worker_entry, ctx, NULL, 1);
+        if (err) {
+            ZF_LOGF("Failed to start worker %d", w);
+        }
+    }
+}
+
+/**
+ * Release the workers into the next run, each with the ctx that
+ * mcmc_ctx_reset got ready for it, and wait for all of them to finish.
+ *
+ * @return the first error any of the workers ran into.
+ */
+static int mcmc_workers_run(void)
+{
+    int err = seL4_NoError;
+
+    __atomic_store_n(&mcmc_smp_done, 0, __ATOMIC_RELAXED);
+    if (__atomic_load_n(&mcmc_smp_run, __ATOMIC_RELAXED)) {
+        /* Every worker is done with the last run, and waits (or is about to) */
+        for (int w = 0; w < MCMC_WORKERS; ++w)
+        {
+            seL4_Signal(mcmc_ctx[w].wake_ntfn.cptr);
+        }
+    }
+    __atomic_fetch_add(&mcmc_smp_run, 1, __ATOMIC_RELEASE);
+    while (__atomic_load_n(&mcmc_smp_done, __ATOMIC_ACQUIRE) < MCMC_WORKERS)
+    {
+        seL4_Wait(mcmc_smp_done_ntfn.cptr, NULL);
+    }
+    for (int w = 0; w < MCMC_WORKERS && err == seL4_NoError; ++w)
+    {
+        err = mcmc_ctx[w].result.error;
+    }
+    return err;
+}
+
+/**
+ * Report every worker on the console and into the result stream, along with
+ * its throughput in requests per million TCB cycles. 'cycles' holds the TCB
+ * and kernel cycles of every worker, if 'have_cycles' is set.
+ */
+static void mcmc_workers_report(bool have_cycles, uint64_t cycles[][2])
+{
+    mrmc_Record record = mrmc_Record_init_zero;
+    mrmc_Worker *worker = &record.payload.worker;
+    uint64_t aggregate = 0;
+
+    printf("\n*********** Workers ***********\n\n");
+    record.which_payload = mrmc_Record_worker_tag;
+    for (int w = 0; w < MCMC_WORKERS; ++w)
+    {
+        const mcmc_result_t *result = &mcmc_ctx[w].result;
+        uint64_t rate = 0;
+
+        worker->core = mcmc_ctx[w].core;
+        worker->iterations = result->iterations;
+        worker->requests = result->requests;
+        worker->total_frames = result->total_frames;
+        worker->error = result->error;
+        worker->has_tcb_cycles = have_cycles;
+        worker->has_kernel_cycles = have_cycles;
+        if (have_cycles) {
+            worker->tcb_cycles = cycles[w][0];
+            worker->kernel_cycles = cycles[w][1];
+            rate = cycles[w][0] ? result->requests * 1000000 / cycles[w][0] : 0;
+            aggregate += rate;
+        }
+        mcmc_result_append(&record);
+        printf("[CORE %d]: requests %zu frames %zu error %d", worker->core,
+               result->requests, result->total_frames, result->error);
+        if (have_cycles) {
+            printf(" tcb %" PRIu64 " kernel %" PRIu64 " requests/Mcycle %" PRIu64,
+                   cycles[w][0], cycles[w][1], rate);
+        }
+        printf("\n");
+    }
+    if (have_cycles) {
+        printf("[SMP]: %d workers, aggregate requests/Mcycle %" PRIu64 "\n", MCMC_WORKERS, aggregate);
+    }
+}
+#endif
+
+#ifdef CONFIG_MRMC_MEMORY_SERVER
+/***
+ * Memory server mode: the allocator sits behind an endpoint of the
+ * rootserver, as it does in a real system, and MRMCServerClients client
+ * processes (client.c) send their requests to it in batches, see
+ * mcmc/server.h. The clients are spawned from the CPIO archive before the
+ * timed region and only resumed once the benchmark counters are reset.
+ * Every request is served with the very same backend as the in-process run
+ * uses, and the frames of every unit handed over to its client (only the
+ * first one without MRMCServerGrantAll), so as the latency the clients see
+ * is the one of the allocator, the IPC and the cap transfer altogether.
+ * The run is over once every client is done.
+ */
+compile_time_assert(mcmc_server_batch_fits, CONFIG_MRMC_SERVER_BATCH <= seL4_MsgMaxLength);
+
+/* Slots of the cspace of a client besides the ones of its handles, for what sel4utils puts there */
+#define MCMC_CLIENT_RESERVED_SLOTS 64
+
+typedef struct mcmc_client {
+    sel4utils_process_t process;
+    /* slot of the cspace of the client that frame 0 of handle 0 goes to */
+    seL4_CPtr slots;
+    /* outstanding units of the client, and the frames granted of them, by handle */
+    mcmc_memory_unit_t **units;
+    uint16_t *granted;
+    mcmc_client_stats_t stats;
+} mcmc_client_t;
+
+static mcmc_client_t mcmc_clients[CONFIG_MRMC_SERVER_CLIENTS];
+static vka_object_t mcmc_server_ep;
+/* only allocated under MCS, which needs a reply object to receive on */
+static vka_object_t mcmc_server_reply;
+/* units and frames outstanding across all clients */
+static size_t mcmc_server_units;
+static size_t mcmc_server_footprint;
+
+/* Handles of every client, at most as many as it may have units outstanding */
+#define MCMC_CLIENT_HANDLES MCMC_MAX_LIVE_UNITS(mcmc_params.free_frequency)
+
+static void mcmc_clients_start(void)
+{
+    static char args[MCMC_CLIENT_ARGS][24];
+    char *argv[MCMC_CLIENT_ARGS];
+    uint32_t handles = MCMC_CLIENT_HANDLES;
+    size_t slots = handles * MCMC_CLIENT_HANDLE_SLOTS;
+    int cnode_bits = 1;
+    cspacepath_t ep;
+
+    if (handles > MCMC_CLIENT_MAX_HANDLES) {
+        ZF_LOGF("Free frequency %u too large for clients", mcmc_params.free_frequency);
+    }
+    while (BIT(cnode_bits) < slots + MCMC_CLIENT_RESERVED_SLOTS)
+    {
+        cnode_bits++;
+    }
+    int err = vka_alloc_endpoint(&env.vka, &mcmc_server_ep);
+    if (err) {
+        ZF_LOGF("Failed to allocate endpoint for the memory server");
+    }
+#ifdef CONFIG_KERNEL_MCS
+    err = vka_alloc_reply(&env.vka, &mcmc_server_reply);
+    if (err) {
+        ZF_LOGF("Failed to allocate reply object for the memory server");
+    }
+#endif
+    vka_cspace_make_path(&env.vka, mcmc_server_ep.cptr, &ep);
+    for (int a = 0; a < MCMC_CLIENT_ARGS; ++a)
+    {
+        argv[a] = args[a];
+    }
+    for (int c = 0; c < CONFIG_MRMC_SERVER_CLIENTS; ++c)
+    {
+        mcmc_client_t *client = &mcmc_clients[c];
+        /* Below the server, so as every message is served as soon as it is sent */
+        sel4utils_process_config_t config = process_config_default_simple(&env.simple, MCMC_CLIENT_IMAGE,
+                                                                          seL4_MaxPrio - 1);
+
+        config = process_config_cnode_size(config, cnode_bits);
+        err = sel4utils_configure_process_custom(&client->process, &env.vka, &env.vspace, config);
+        if (err) {
+            ZF_LOGF("Failed to configure client %d", c);
+        }
+        /* The badge tells the clients apart */
+        seL4_CPtr endpoint = sel4utils_mint_cap_to_process(&client->process, ep, seL4_AllRights, c + 1);
+        client->slots = client->process.cspace_next_free;
+        if (endpoint == seL4_CapNull || client->slots + slots > BIT(cnode_bits)) {
+            ZF_LOGF("Out of slots in the cspace of client %d", c);
+        }
+        client->units = (mcmc_memory_unit_t **)mcmc_pages_reserve(handles * sizeof(*client->units));
+        client->granted = (uint16_t *)mcmc_pages_reserve(handles * sizeof(*client->granted));
+
+        snprintf(args[MCMC_CLIENT_ARG_INDEX], sizeof(args[0]), "%d", c);
+        snprintf(args[MCMC_CLIENT_ARG_ENDPOINT], sizeof(args[0]), "%lu", (unsigned long)endpoint);
+        snprintf(args[MCMC_CLIENT_ARG_SLOTS], sizeof(args[0]), "%lu", (unsigned long)client->slots);
+        snprintf(args[MCMC_CLIENT_ARG_ITERATIONS], sizeof(args[0]), "%u", mcmc_params.iterations);
+        snprintf(args[MCMC_CLIENT_ARG_FREE_FREQUENCY], sizeof(args[0]), "%u", mcmc_params.free_frequency);
+        snprintf(args[MCMC_CLIENT_ARG_POLICY], sizeof(args[0]), "%d", mcmc_params.policy);
+        snprintf(args[MCMC_CLIENT_ARG_SEED], sizeof(args[0]), "%" PRIu64, mcmc_params.seed);
+        snprintf(args[MCMC_CLIENT_ARG_BATCH], sizeof(args[0]), "%d", CONFIG_MRMC_SERVER_BATCH);
+        /* The arguments are copied onto the stack of the client */
+        err = sel4utils_spawn_process_v(&client->process, &env.vka, &env.vspace, MCMC_CLIENT_ARGS, argv, 0);
+        if (err) {
+            ZF_LOGF("Failed to spawn client %d", c);
+        }
+    }
+}
+
+/* Slot of the cspace of a client that frame 'frame' of 'handle' goes to */
+static void mcmc_client_slot(mcmc_client_t *client, uint32_t handle, uint32_t frame, cspacepath_t *path)
+{
+    *path = (cspacepath_t) {
+        .root = client->process.cspace.cptr,
+        .capPtr = client->slots + mcmc_client_frame_slot(handle, frame),
+        .capDepth = client->process.cspace_size,
+    };
+}
+
+/* Take the frames of 'handle' back from its client, deleting an empty slot is no error */
+static void mcmc_server_ungrant(mcmc_client_t *client, uint32_t handle, uint32_t frame_count)
+{
+    cspacepath_t slot;
+
+    for (uint32_t f = 0; f < frame_count; ++f)
+    {
+        mcmc_client_slot(client, handle, f, &slot);
+        int err = vka_cnode_delete(&slot);
+        if (err) {
+            assert(0);
+        }
+    }
+}
+
+/**
+ * Hand a unit of 'frame_count' frames over to its client: copies of its
+ * frames go into the slots of its handle, every one of them with
+ * MRMCServerGrantAll, else only the first one. The copies are part of the
+ * latency the client sees, one seL4_CNode_Copy per frame, which weighs on
+ * the large units above all.
+ */
+static int mcmc_server_grant(vka_t *vka, mcmc_client_t *client, uint32_t handle, mcmc_memory_unit_t *unit,
+                             uint32_t frame_count)
+{
+    uint32_t granted = MIN(frame_count, MCMC_CLIENT_HANDLE_SLOTS);
+    cspacepath_t slot;
+
+    mcmc_client_slot(client, handle, 0, &slot);
+    int err = mcmc_memory_unit_grant(vka, unit, frame_count, granted, slot);
+    if (err) {
+        mcmc_server_ungrant(client, handle, granted);
+        return err;
+    }
+    client->granted[handle] = granted;
+    return seL4_NoError;
+}
+
+static int mcmc_server_alloc(mcmc_ctx_t *ctx, vka_t *vka, mcmc_client_t *client, uint32_t handle,
+                             uint32_t frame_count)
+{
+    mcmc_memory_unit_t *unit;
+    int order = mcmc_frame_order(frame_count);
+    int err;
+
+    if (client->units[handle]) {
+        /* still outstanding */
+        return seL4_DeleteFirst;
+    }
+    unit = (mcmc_memory_unit_t *)mcmc_slab_alloc(&ctx->unit_slab);
+    if (unit == NULL) {
+        return seL4_NotEnoughMemory;
+    }
+    MCMC_LATENCY_START(ta_start, &ctx->alloc_latency[order]);
+    ccnt_t op_start = sel4bench_get_cycle_count();
+    err = mcmc_backend_alloc(ctx, vka, unit, frame_count);
+    mcmc_op_alloc_cycles(ctx, MCMC_OBJECT_FRAMES, sel4bench_get_cycle_count() - op_start);
+    MCMC_LATENCY_END(ta_start);
+    if (err) {
+        mcmc_slab_free(&ctx->unit_slab, unit);
+        return err;
+    }
+    err = mcmc_server_grant(vka, client, handle, unit, frame_count);
+    if (err) {
+        mcmc_memory_unit_release(ctx, vka, unit);
+        return err;
+    }
+    client->units[handle] = unit;
+    ctx->result.requests++;
+    ctx->result.total_frames += frame_count;
+    mcmc_server_units++;
+    mcmc_server_footprint += BIT(order);
+    ctx->result.peak_units = MAX(ctx->result.peak_units, mcmc_server_units);
+    ctx->result.peak_footprint = MAX(ctx->result.peak_footprint, mcmc_server_footprint);
+    return seL4_NoError;
+}
+
+static int mcmc_server_free(mcmc_ctx_t *ctx, vka_t *vka, mcmc_client_t *client, uint32_t handle)
+{
+    mcmc_memory_unit_t *unit = client->units[handle];
+
+    if (unit == NULL) {
+        return seL4_FailedLookup;
+    }
+    int order = mcmc_memory_unit_order(unit);
+
+    /* Take the frames back from the client first */
+    mcmc_server_ungrant(client, handle, client->granted[handle]);
+    client->units[handle] = NULL;
+    mcmc_server_units--;
+    mcmc_server_footprint -= BIT(order);
+
+    MCMC_LATENCY_START(tf_start, &ctx->free_latency[order]);
+    ccnt_t op_start = sel4bench_get_cycle_count();
+    mcmc_memory_unit_release(ctx, vka, unit);
+    mcmc_op_free_cycles(ctx, MCMC_OBJECT_FRAMES, sel4bench_get_cycle_count() - op_start);
+    MCMC_LATENCY_END(tf_start);
+    return seL4_NoError;
+}
+
+/**
+ * Serve one message of a client.
+ *
+ * @return the reply, the error of every request of the batch in order.
+ */
+static seL4_MessageInfo_t mcmc_server_batch(mcmc_ctx_t *ctx, vka_t *vka, mcmc_client_t *client,
+                                            seL4_MessageInfo_t info)
+{
+    uint32_t ops[CONFIG_MRMC_SERVER_BATCH];
+    int errors[CONFIG_MRMC_SERVER_BATCH];
+    seL4_Word count = seL4_MessageInfo_get_length(info);
+
+    /* Anything else gets an empty reply, which no client takes for an answer */
+    if (seL4_MessageInfo_get_label(info) != MCMC_SERVER_BATCH || count > CONFIG_MRMC_SERVER_BATCH) {
+        return seL4_MessageInfo_new(0, 0, 0, 0);
+    }
+    /* Every invocation of the allocator overwrites the message registers */
+    for (seL4_Word m = 0; m < count; ++m)
+    {
+        ops[m] = seL4_GetMR(m);
+    }
+    for (seL4_Word m = 0; m < count; ++m)
+    {
+        uint32_t handle = mcmc_server_op_handle(ops[m]);
+
+        if (handle >= MCMC_CLIENT_HANDLES) {
+            errors[m] = seL4_RangeError;
+        } else if (ops[m] & MCMC_SERVER_FREE) {
+            errors[m] = mcmc_server_free(ctx, vka, client, handle);
+        } else {
+            errors[m] = mcmc_server_alloc(ctx, vka, client, handle, mcmc_server_op_frames(ops[m]));
+        }
+    }
+    for (seL4_Word m = 0; m < count; ++m)
+    {
+        seL4_SetMR(m, errors[m]);
+    }
+    ctx->result.batches++;
+    return seL4_MessageInfo_new(0, 0, 0, count);
+}
+
+/* Take the statistics of a client which is done, the run took as many iterations as the shortest client */
+static void mcmc_server_done(mcmc_ctx_t *ctx, mcmc_client_t *client)
+{
+    memcpy(&client->stats, seL4_GetIPCBuffer()->msg, sizeof(client->stats));
+    ctx->result.iterations = MIN(ctx->result.iterations, (int)client->stats.iterations);
+    ctx->result.round_trip_cycles += client->stats.round_trip_sum;
+    if (ctx->result.error == seL4_NoError) {
+        ctx->result.error = client->stats.error;
+    }
+}
+
+/**
+ * Resume the clients and serve them until all of them are done.
+ *
+ * @return the first error any of the clients ran into.
+ */
+static int mcmc_server_run(mcmc_ctx_t *ctx)
+{
+    vka_t *vka = &env.vka;
+    seL4_MessageInfo_t info;
+    seL4_Word badge;
+    int done = 0;
+
+    mcmc_server_units = 0;
+    mcmc_server_footprint = 0;
+    ctx->result.iterations = INT_MAX;
+    for (int c = 0; c < CONFIG_MRMC_SERVER_CLIENTS; ++c)
+    {
+        seL4_TCB_Resume(mcmc_clients[c].process.thread.tcb.cptr);
+    }
+    info = api_recv(mcmc_server_ep.cptr, &badge, mcmc_server_reply.cptr);
+    for (;;)
+    {
+        assert(badge >= 1 && badge <= CONFIG_MRMC_SERVER_CLIENTS);
+        mcmc_client_t *client = &mcmc_clients[badge - 1];
+
+        if (seL4_MessageInfo_get_label(info) == MCMC_SERVER_DONE) {
+            mcmc_server_done(ctx, client);
+            if (++done == CONFIG_MRMC_SERVER_CLIENTS) {
+                break;
+            }
+            /* Left without a reply, see client.c */
+            info = api_recv(mcmc_server_ep.cptr, &badge, mcmc_server_reply.cptr);
+            continue;
+        }
+        info = mcmc_server_batch(ctx, vka, client, info);
+        info = api_reply_recv(mcmc_server_ep.cptr, info, &badge, mcmc_server_reply.cptr);
+    }
+    return ctx->result.error;
+}
+
+/**
+ * Report every client on the console and into the result stream, and the
+ * throughput of the server in requests (frees included) per million cycles
+ * of the run. The mean cycles per batch and per request end to end are
+ * reported apart from the cycles per request spent in the allocator.
+ */
+static void mcmc_clients_report(const mcmc_result_t *total)
+{
+    mrmc_Record record = mrmc_Record_init_zero;
+    mrmc_Client *client = &record.payload.client;
+    uint64_t requests = total->requests + total->frees;
+    uint64_t allocator = total->alloc_cycles + total->free_cycles;
+
+    printf("\n*********** Clients ***********\n\n");
+    record.which_payload = mrmc_Record_client_tag;
+    for (int c = 0; c < CONFIG_MRMC_SERVER_CLIENTS; ++c)
+    {
+        const mcmc_client_stats_t *stats = &mcmc_clients[c].stats;
+
+        client->index = c;
+        client->iterations = stats->iterations;
+        client->requests = stats->requests;
+        client->frees = stats->frees;
+        client->total_frames = stats->total_frames;
+        client->error = stats->error;
+        client->batches = stats->batches;
+        client->round_trip_sum = stats->round_trip_sum;
+        client->batch_p50 = stats->batch_p50;
+        client->batch_p99 = stats->batch_p99;
+        client->batch_max = stats->batch_max;
+        client->request_p50 = stats->request_p50;
+        client->request_p99 = stats->request_p99;
+        client->request_max = stats->request_max;
+        client->cycles = stats->cycles;
+        mcmc_result_append(&record);
+        printf("[CLIENT %d]: requests %" PRIu64 " frees %" PRIu64 " frames %" PRIu64 " error %d batches %" PRIu64
+               "\n", c, stats->requests, stats->frees, stats->total_frames, (int)stats->error, stats->batches);
+        printf("[CLIENT %d]: cycles per batch p50 %" PRIu64 " p99 %" PRIu64 " max %" PRIu64
+               ", per request p50 %" PRIu64 " p99 %" PRIu64 " max %" PRIu64 "\n", c, stats->batch_p50,
+               stats->batch_p99, stats->batch_max, stats->request_p50, stats->request_p99, stats->request_max);
+    }
+    printf("[SERVER]: %d clients, batches of %d, %s frame of every unit granted, %zu messages, requests/Mcycle %"
+           PRIu64 "\n", CONFIG_MRMC_SERVER_CLIENTS, CONFIG_MRMC_SERVER_BATCH,
+           MCMC_CLIENT_HANDLE_SLOTS > 1 ? "every" : "the first", total->batches,
+           total->cycles ? requests * 1000000 / total->cycles : 0);
+    printf("[SERVER]: end to end, cycles per batch %" PRIu64 " per request %" PRIu64 "\n",
+           total->batches ? total->round_trip_cycles / total->batches : 0,
+           requests ? total->round_trip_cycles / requests : 0);
+    printf("[SERVER]: in the allocator, cycles per request %" PRIu64 "\n", requests ? allocator / requests : 0);
+}
+#endif
+
+/**
+ * Sum up the results of all workers, the first error (if any) ends up in
+ * 'total' and its iterations are the least any worker got through.
+ */
+static void mcmc_result_total(mcmc_result_t *total)
+{
+    *total = mcmc_ctx[0].result;
+    for (int w = 1; w < MCMC_WORKERS; ++w)
+    {
+        const mcmc_result_t *result = &mcmc_ctx[w].result;
+
+        total->iterations = MIN(total->iterations, result->iterations);
+        total->requests += result->requests;
+#if defined(CONFIG_MRMC_CALIBRATE) && defined(CONFIG_MRMC_SMP_WORKERS)
+        total->worker_cycles += result->worker_cycles;
+#endif
+        total->total_frames += result->total_frames;
+        total->magazine_hits += result->magazine_hits;
+        total->magazine_misses += result->magazine_misses;
+        total->magazine_drained += result->magazine_drained;
+        total->peak_footprint += result->peak_footprint;
+        total->footprint_sum += result->footprint_sum;
+        total->peak_units += result->peak_units;
+        total->alloc_cycles += result->alloc_cycles;
+        total->free_cycles += result->free_cycles;
+        total->frees += result->frees;
+#ifdef CONFIG_MRMC_OBJECT_MIX
+        for (int kind = 0; kind < MCMC_OBJECTS; ++kind)
+        {
+            mcmc_object_stats_t *sum = &total->objects[kind];
+            const mcmc_object_stats_t *stats = &result->objects[kind];
+
+            sum->allocs += stats->allocs;
+            sum->frees += stats->frees;
+            sum->alloc_cycles += stats->alloc_cycles;
+            sum->free_cycles += stats->free_cycles;
+            sum->alloc_max = MAX(sum->alloc_max, stats->alloc_max);
+            sum->free_max = MAX(sum->free_max, stats->free_max);
+        }
+#endif
+        if (result->epochs && (total->epochs == 0 || result->epoch_order_min < total->epoch_order_min)) {
+            total->epoch_order_min = result->epoch_order_min;
+        }
+        total->epochs += result->epochs;
+        total->max_epoch_units = MAX(total->max_epoch_units, result->max_epoch_units);
+        total->epoch_order_sum += result->epoch_order_sum;
+        if (result->failures && (total->failures == 0 || result->first_failure < total->first_failure)) {
+            total->first_failure = result->first_failure;
+        }
+        total->failures += result->failures;
+        total->mapped_pages += result->mapped_pages;
+        total->mapped_large_pages += result->mapped_large_pages;
+        total->large_page_cycles += result->large_page_cycles;
+        total->probe_cycles += result->probe_cycles;
+        total->probe_kernel_cycles += result->probe_kernel_cycles;
+        total->map_cycles += result->map_cycles;
+        total->unmap_cycles += result->unmap_cycles;
+        total->paging_objects += result->paging_objects;
+        if (total->error == seL4_NoError) {
+            total->error = result->error;
+        }
+    }
+}
+
+#if defined(CONFIG_MRMC_SCHEDULE) || defined(CONFIG_MRMC_OBJECT_MIX)
+/* Most iterations of any run of the boot, which the arrays drawn before a run hold */
+static uint32_t mcmc_draw_length;
+#endif
+
+#if defined(CONFIG_MRMC_OBJECT_MIX) && !defined(CONFIG_MRMC_SCHEDULE)
+/**
+ * Draw the kinds of all requests of a run before it starts, first thing
+ * from the stream of the worker, so as the timed loop pays nothing for
+ * them, see mcmc_driver_alloc.
+ */
+static void mcmc_objects_draw(mcmc_ctx_t *ctx)
+{
+    assert(mcmc_params.iterations <= mcmc_draw_length);
+    mcmc_workload_objects(&ctx->rng, &mcmc_object_mix, ctx->objects, mcmc_params.iterations);
+}
+#endif
+
+#ifdef CONFIG_MRMC_SCHEDULE
+/***
+ * Schedules: with MRMCSchedule, every worker draws all the requests of a
+ * run before it starts, from the very same stream and in the very same
+ * order as it would draw them one per iteration, so as the timed loop only
+ * streams through a packed array and pays nothing for random numbers. With
+ * MRMCObjectMix, the schedule holds the kinds of the requests as well.
+ */
+static void mcmc_schedule_draw(mcmc_ctx_t *ctx)
+{
+#ifdef CONFIG_MRMC_OBJECT_MIX
+    const mcmc_dist_t *mix = &mcmc_object_mix;
+#else
+    const mcmc_dist_t *mix = NULL;
+#endif
+
+    assert(mcmc_params.iterations <= mcmc_draw_length);
+    if (mcmc_workload_schedule(&ctx->rng, &mcmc_size_dist, mix, mcmc_params.free_frequency,
+                               ctx->schedule, mcmc_params.iterations)) {
+        ZF_LOGF("Free frequency %u too large for a schedule", mcmc_params.free_frequency);
+    }
+}
+#endif
+
+/* Get a worker ready for the next run with mcmc_params */
+static void mcmc_ctx_reset(mcmc_ctx_t *ctx)
+{
+    mcmc_rng_seed(&ctx->rng, mcmc_params.seed, ctx->core);
+#ifdef CONFIG_MRMC_SCHEDULE
+    mcmc_schedule_draw(ctx);
+#elif defined(CONFIG_MRMC_OBJECT_MIX)
+    mcmc_objects_draw(ctx);
+#endif
+#ifndef CONFIG_MRMC_MEMORY_SERVER
+#ifdef MCMC_COUNT_FAILURES
+    /* Failed requests are dropped, see mcmc_capacity_run and mcmc_replicas_run */
+    mcmc_driver_init(&ctx->driver, &mcmc_driver_ops, ctx, MCMC_FREE_EPOCH_LENGTH, true);
+#else
+    mcmc_driver_init(&ctx->driver, &mcmc_driver_ops, ctx, MCMC_FREE_EPOCH_LENGTH, false);
+#endif
+#endif
+    ctx->cursor = 0;
+    memset(&ctx->result, 0, sizeof(ctx->result));
+#ifdef CONFIG_MRMC_LATENCY_HISTOGRAM
+    mcmc_latency_init(ctx);
+#endif
+}
+
+#ifdef MCMC_MULTI_RUN
+/**
+ * Free every unit still outstanding after a run (or left behind by a failed
+ * one), as well as the magazines of the worker.
+ *
+ * @return true if the bookkeeping arenas of the worker are empty again.
+ */
+static bool mcmc_teardown(mcmc_ctx_t *ctx, vka_t *vka)
+{
+    mcmc_wheel_node_t *tf = mcmc_driver_drain(&ctx->driver);
+
+    while (tf)
+    {
+        mcmc_memory_unit_t *tx = mcmc_memory_unit_of(tf);
+        tf = tf->next;
+#ifdef CONFIG_MRMC_MAP_TOUCH
+        mcmc_memory_unit_unmap(ctx, vka, tx);
+#endif
+        mcmc_memory_unit_release(ctx, vka, tx);
+    }
+#ifdef CONFIG_MRMC_MAGAZINE
+    mcmc_magazine_flush(ctx, vka);
+#endif
+    return ctx->unit_slab.in_use == 0 && ctx->object_slab.in_use == 0
+#if !(ENABLE_CAPBUDDY_EXTENSION) && !defined(CONFIG_MRMC_BULK_RETYPE)
+           && ctx->frame_slab.in_use == 0
+#endif
+           ;
+}
+
+/***
+ * After every run of a sweep or a capacity search, all outstanding units
+ * are freed again, and the run only counts as clean if the bookkeeping
+ * arenas are empty and just as many blocks of the largest order are
+ * allocatable as right before the run, that is, nothing leaked and the
+ * allocator coalesced everything back. allocman grows its own metadata
+ * lazily (out of the same untyped memory) while the probe splits it up, so
+ * the very first probe of a boot is a throwaway that grows it up front,
+ * and the counts before and after every run must match exactly from then
+ * on.
+ */
+#define MCMC_PROBE_BLOCKS 4096
+
+static vka_object_t *mcmc_probes;
+
+/**
+ * Count how many blocks of the largest order (up to MCMC_PROBE_BLOCKS) are
+ * allocatable at once, and give them all back.
+ */
+static size_t mcmc_free_blocks(vka_t *vka)
+{
+    size_t count = 0;
+
+    while (count < MCMC_PROBE_BLOCKS &&
+           mcmc_block_alloc(vka, MCMC_MAX_ORDER, &mcmc_probes[count]) == seL4_NoError)
+    {
+        count++;
+    }
+    for (size_t b = 0; b < count; ++b)
+    {
+        vka_free_object(vka, &mcmc_probes[b]);
+    }
+    return count;
+}
+#endif
+
+#ifdef CONFIG_MRMC_SWEEP
+/***
+ * Sweep mode: a single boot runs the whole grid of MRMCSweepPolicies x
+ * MRMCSweepFreeFrequencies x MRMCSweepIterations x MRMCSweepSeeds, and
+ * every run is reported (and dumped into the result stream) on its own.
+ */
+static mcmc_sweep_t mcmc_sweep;
+
+/**
+ * Parse the grid.
+ *
+ * @return the largest free frequency of the grid, for sizing the arenas.
+ */
+static uint32_t mcmc_sweep_init(void)
+{
+    if (mcmc_sweep_parse(&mcmc_sweep, MCMC_SWEEP_POLICY, CONFIG_MRMC_SWEEP_POLICIES,
+                         mcmc_policy_names, MCMC_POLICIES, 0) ||
+        mcmc_sweep_parse(&mcmc_sweep, MCMC_SWEEP_FREE_FREQUENCY, CONFIG_MRMC_SWEEP_FREE_FREQUENCIES, NULL, 0, 2) ||
+        mcmc_sweep_parse(&mcmc_sweep, MCMC_SWEEP_ITERATIONS, CONFIG_MRMC_SWEEP_ITERATIONS, NULL, 0, 1) ||
+        mcmc_sweep_parse(&mcmc_sweep, MCMC_SWEEP_SEED, CONFIG_MRMC_SWEEP_SEEDS, NULL, 0, 0)) {
+        ZF_LOGF("Invalid sweep specification");
+    }
+    return mcmc_sweep_max(&mcmc_sweep, MCMC_SWEEP_FREE_FREQUENCY);
+}
+#endif
+
+/**
+ * Run the simulation once with mcmc_params on every worker, and report it
+ * (into its own dump of the result stream) once the benchmark counters
+ * have been read.
+ *
+ * @return the first error any of the workers ran into.
+ */
+static int mcmc_run(mcmc_result_t *total)
+{
+    int err;
+    bool have_cycles = false;
+    uint64_t tcb_cycles = 0;
+    uint64_t kernel_cycles = 0;
+
+    for (int w = 0; w < MCMC_WORKERS; ++w)
+    {
+        mcmc_ctx_reset(&mcmc_ctx[w]);
+    }
+#ifdef MCMC_MULTI_RUN
+    static bool probed;
+    if (!probed) {
+        mcmc_free_blocks(&env.vka);
+        probed = true;
+    }
+    size_t free_blocks = mcmc_free_blocks(&env.vka);
+#endif
+#ifdef CONFIG_MRMC_METADATA_REPORT
+    size_t metadata_start = mcmc_metadata_bytes;
+    mcmc_metadata_peak = metadata_start;
+#endif
+#ifdef MCMC_TRACK_UTILISATION
+    printf("\n*********** Benchmark ***********\n\n");
+    uint64_t *ipcbuffer = (uint64_t *)&(seL4_GetIPCBuffer()->msg[0]);
+#ifdef CONFIG_MRMC_SMP_WORKERS
+    static uint64_t cycles[MCMC_WORKERS][2];
+    for (int w = 0; w < MCMC_WORKERS; ++w)
+    {
+        seL4_BenchmarkResetThreadUtilisation(mcmc_ctx[w].thread.tcb.cptr);
+    }
+#else
+    seL4_BenchmarkResetThreadUtilisation(simple_get_tcb(&env.simple));
+#endif
+    seL4_BenchmarkResetLog();
+#endif
+#ifdef CONFIG_MRMC_KERNEL_ENTRIES
+    seL4_BenchmarkResetLog();
+#endif
+#ifdef MCMC_RUN_CYCLES
+    ccnt_t start = sel4bench_get_cycle_count();
+#endif
+#ifdef CONFIG_MRMC_SMP_WORKERS
+    err = mcmc_workers_run();
+#elif defined(CONFIG_MRMC_MEMORY_SERVER)
+    err = mcmc_server_run(&mcmc_ctx[0]);
+#else
+    err = mcmc_exp_simulation(&mcmc_ctx[0]);
+#endif
+    mcmc_result_total(total);
+#ifdef MCMC_RUN_CYCLES
+    total->cycles = sel4bench_get_cycle_count() - start;
+#ifndef CONFIG_MRMC_SMP_WORKERS
+    /* Workers probe side by side, so only a lone run can take its probes off the clock */
+    total->cycles -= total->probe_cycles;
+#endif
+#endif
+#ifdef CONFIG_MRMC_METADATA_REPORT
+    total->metadata_start = metadata_start;
+    total->metadata_peak = mcmc_metadata_peak;
+#endif
+#ifdef CONFIG_MRMC_KERNEL_ENTRIES
+    total->kernel_log_entries = MIN(seL4_BenchmarkFinalizeLog(), MCMC_KERNEL_LOG_ENTRIES);
+    mcmc_kernel_log_sum(total->kernel_log_entries);
+#endif
+#ifdef MCMC_TRACK_UTILISATION
+    seL4_BenchmarkFinalizeLog();
+#ifdef CONFIG_MRMC_SMP_WORKERS
+    for (int w = 0; w < MCMC_WORKERS; ++w)
+    {
+        seL4_BenchmarkGetThreadUtilisation(mcmc_ctx[w].thread.tcb.cptr);
+        cycles[w][0] = ipcbuffer[BENCHMARK_TCB_UTILISATION] - mcmc_ctx[w].result.probe_cycles;
+        cycles[w][1] = ipcbuffer[BENCHMARK_TCB_KERNEL_UTILISATION] - mcmc_ctx[w].result.probe_kernel_cycles;
+        tcb_cycles += cycles[w][0];
+        kernel_cycles += cycles[w][1];
+    }
+    mcmc_workers_report(true, cycles);
+#else
+    seL4_BenchmarkGetThreadUtilisation(simple_get_tcb(&env.simple));
+    tcb_cycles = ipcbuffer[BENCHMARK_TCB_UTILISATION];
+    kernel_cycles = ipcbuffer[BENCHMARK_TCB_KERNEL_UTILISATION];
+    tcb_cycles -= total->probe_cycles;
+    kernel_cycles -= total->probe_kernel_cycles;
+#endif
+    have_cycles = true;
+#ifdef CONFIG_MRMC_CALIBRATE
+    total->tcb_cycles = tcb_cycles;
+    total->kernel_cycles = kernel_cycles;
+#endif
+#elif defined(CONFIG_MRMC_SMP_WORKERS)
+    mcmc_workers_report(false, NULL);
+#endif
+#ifdef MCMC_MULTI_RUN
+    total->clean = true;
+    for (int w = 0; w < MCMC_WORKERS; ++w)
+    {
+        total->clean = mcmc_teardown(&mcmc_ctx[w], &env.vka) && total->clean;
+    }
+    size_t free_blocks_after = mcmc_free_blocks(&env.vka);
+    total->clean = total->clean && free_blocks_after == free_blocks;
+    printf("[TEARDOWN]: %s, free blocks of order %d: %zu before, %zu after\n",
+           total->clean ? "clean" : "NOT clean", MCMC_MAX_ORDER, free_blocks, free_blocks_after);
+#endif
+    mcmc_result_report(total, have_cycles, tcb_cycles, kernel_cycles);
+#ifdef CONFIG_MRMC_OBJECT_MIX
+    mcmc_object_report(total);
+#endif
+#ifdef CONFIG_MRMC_MEMORY_SERVER
+    mcmc_clients_report(total);
+#endif
+#ifdef CONFIG_MRMC_KERNEL_ENTRIES
+    mcmc_kernel_log_report(total->kernel_log_entries);
+#endif
+    if (have_cycles) {
+        printf("\n*********** Benchmark ***********\n");
+        printf("\nCPU cycles spent (TCB-Schedule): %" PRIu64 "\n", tcb_cycles);
+        printf("\nCPU cycles spent (TCB-Kernel): %" PRIu64 "\n", kernel_cycles);
+    }
+    printf("\nPeak footprint: %zu frames\n", total->peak_footprint);
+#ifdef CONFIG_MRMC_METADATA_REPORT
+    /* what allocman grew by, per frame of the peak footprint, in thousandths of a byte */
+    size_t metadata_growth = total->metadata_peak - total->metadata_start;
+    size_t per_frame = total->peak_footprint ? metadata_growth * 1000 / total->peak_footprint : 0;
+    printf("\n[METADATA]: %zu bytes before the run, peak %zu bytes, %zu.%03zu bytes per frame"
+           " (pool of %zu bytes)\n", total->metadata_start, total->metadata_peak,
+           per_frame / 1000, per_frame % 1000, mcmc_virtual_pool_size());
+#endif
+#ifdef CONFIG_MRMC_MAP_TOUCH
+    printf("\n[MAP]: %s: %zu pages mapped (%zu large), %zu paging objects, cycles map+touch %" PRIu64
+           " unmap %" PRIu64 " large pages %" PRIu64 "\n", MCMC_ALLOCATOR_NAME, total->mapped_pages,
+           total->mapped_large_pages, total->paging_objects, total->map_cycles, total->unmap_cycles,
+           total->large_page_cycles);
+#endif
+#ifdef CONFIG_MRMC_FREE_EPOCH
+    printf("\nFree epochs of %d iterations: %zu, largest batch %zu units\n",
+           CONFIG_MRMC_FREE_EPOCH_LENGTH, total->epochs, total->max_epoch_units);
+    if (total->epochs) {
+        /* in hundredths, -1 (MCMC_SAMPLE_EXHAUSTED) for a batch after which nothing was left */
+        int64_t mean = total->epoch_order_sum * 100 / (int64_t)total->epochs;
+        int64_t magnitude = mean < 0 ? -mean : mean;
+
+        printf("Largest allocatable order after a batch (of %d): least %d, mean %s%" PRId64 ".%02" PRId64 "\n",
+               MCMC_MAX_ORDER, total->epoch_order_min, mean < 0 ? "-" : "", magnitude / 100, magnitude % 100);
+    }
+#endif
+#ifdef MCMC_PROBE_CYCLES
+    printf("\nProbes of the largest allocatable order: %" PRIu64 " cycles (%" PRIu64 " in the kernel), not counted"
+           " into the cycles of the run\n", total->probe_cycles, total->probe_kernel_cycles);
+#endif
+#ifdef CONFIG_MRMC_MAGAZINE
+    printf("\nMagazine hits/misses/drained: %zu/%zu/%zu\n",
+           total->magazine_hits, total->magazine_misses, total->magazine_drained);
+    for (int w = 0; w < MCMC_WORKERS; ++w)
+    {
+        mcmc_magazine_flush(&mcmc_ctx[w], &env.vka);
+    }
+#endif
+#ifdef CONFIG_MRMC_LATENCY_HISTOGRAM
+    mcmc_latency_print();
+#endif
+#ifdef CONFIG_MRMC_SAMPLER
+    mcmc_sampler_report();
+#endif
+    mcmc_result_flush();
+    return err;
+}
+
+#ifdef CONFIG_MRMC_SWEEP
+/**
+ * Run every point of the grid, carrying on past failed runs.
+ *
+ * @return the first error any of the runs ran into.
+ */
+static int mcmc_sweep_run(void)
+{
+    size_t points = mcmc_sweep_points(&mcmc_sweep);
+    size_t failed = 0;
+    size_t unclean = 0;
+    int err = seL4_NoError;
+    mcmc_result_t total;
+
+    for (size_t p = 0; p < points; ++p)
+    {
+        mcmc_sweep_point_t point;
+
+        mcmc_sweep_point(&mcmc_sweep, p, &point);
+        mcmc_params.policy = point.policy;
+        mcmc_params.free_frequency = point.free_frequency;
+        mcmc_params.iterations = point.iterations;
+        mcmc_params.seed = point.seed;
+        mcmc_size_policy_init(mcmc_params.policy);
+        printf("\n[SWEEP %zu/%zu]: policy %s free frequency %u iterations %u seed %u\n", p + 1, points,
+               mcmc_policy_names[point.policy], point.free_frequency, point.iterations, point.seed);
+
+        int run_err = mcmc_run(&total);
+        if (run_err != seL4_NoError) {
+            failed++;
+            if (err == seL4_NoError) {
+                err = run_err;
+            }
+        }
+        if (!total.clean) {
+            unclean++;
+        }
+    }
+    printf("\n[SWEEP]: %zu runs, %zu failed, %zu not clean\n", points, failed, unclean);
+    return err;
+}
+#endif
+
+#ifdef CONFIG_MRMC_CAPACITY_SEARCH
+/**
+ * Capacity search: binary search the largest free frequency in
+ * [2, MRMCCapacityMaxFreeFrequency] at which a run of MRMCCapacityIterations
+ * iterations does not fail a single allocation, assuming that a higher
+ * load never fails less. Every probe is a run of its own, and failed
+ * allocations are counted rather than ending it.
+ *
+ * @return the first error other than a failed allocation.
+ */
+static int mcmc_capacity_run(void)
+{
+    /* largest free frequency known to be sustainable (1: nothing ever outstanding) */
+    uint32_t lo = 1;
+    /* smallest free frequency known to fail */
+    uint32_t hi = CONFIG_MRMC_CAPACITY_MAX_FREE_FREQUENCY + 1;
+    size_t unclean = 0;
+    size_t runs = 0;
+    mcmc_result_t total;
+
+    mcmc_params.iterations = CONFIG_MRMC_CAPACITY_ITERATIONS;
+    while (hi - lo > 1)
+    {
+        uint32_t free_frequency = lo + (hi - lo) / 2;
+
+        mcmc_params.free_frequency = free_frequency;
+        printf("\n[CAPACITY %zu]: free frequency %u (sustainable %u, failing %u), load %" PRIu64 " frames\n",
+               ++runs, free_frequency, lo, hi, mcmc_capacity_load(free_frequency));
+
+        int err = mcmc_run(&total);
+        if (err != seL4_NoError) {
+            return err;
+        }
+        if (!total.clean) {
+            unclean++;
+        }
+        if (total.failures == 0) {
+            lo = free_frequency;
+        } else {
+            hi = free_frequency;
+        }
+    }
+    printf("\n[CAPACITY]: %zu runs, %zu not clean, %zu frames of untyped memory\n",
+           runs, unclean, mcmc_untyped_frames());
+    if (lo < 2) {
+        printf("[CAPACITY]: %s fails at any load\n", MCMC_ALLOCATOR_NAME);
+    } else if (hi > CONFIG_MRMC_CAPACITY_MAX_FREE_FREQUENCY) {
+        printf("[CAPACITY]: %s sustains free frequency %u (load %" PRIu64 " frames), the top of the search\n",
+               MCMC_ALLOCATOR_NAME, lo, mcmc_capacity_load(lo));
+    } else {
+        printf("[CAPACITY]: %s sustains free frequency %u (load %" PRIu64 " frames), fails at %u\n",
+               MCMC_ALLOCATOR_NAME, lo, mcmc_capacity_load(lo), hi);
+    }
+    return seL4_NoError;
+}
+#endif
+
+#ifdef CONFIG_MRMC_SCALING
+/***
+ * Scaling: runs of MRMCScalingIterations iterations at free frequencies
+ * growing 4-fold from MRMCScalingStart up to MRMCScalingMax, so as the
+ * outstanding units and frames (and the caps held for them: one per frame
+ * and one per untyped for the cascading allocator) grow by orders of
+ * magnitude, with the mean cycles per allocation and per free at each
+ * step. Failed allocations are counted, and the steps end with the first
+ * run that has any, as the cspace (or the memory) is then exhausted. With
+ * MRMCSmpWorkers, every worker runs each step on its own, and the figures
+ * of a step are those of all workers together.
+ */
+static int mcmc_scaling_run(void)
+{
+    size_t unclean = 0;
+    size_t steps = 0;
+    mcmc_result_t total;
+
+    mcmc_params.iterations = CONFIG_MRMC_SCALING_ITERATIONS;
+    for (uint32_t free_frequency = CONFIG_MRMC_SCALING_START;
+         free_frequency <= CONFIG_MRMC_SCALING_MAX_FREE_FREQUENCY; free_frequency *= 4)
+    {
+        mcmc_params.free_frequency = free_frequency;
+        printf("\n[SCALING %zu]: free frequency %u\n", ++steps, free_frequency);
+
+        int err = mcmc_run(&total);
+        if (err != seL4_NoError) {
+            return err;
+        }
+        /* Failures are counted, so every worker gets through every iteration of the step */
+        if ((uint32_t)total.iterations != mcmc_params.iterations) {
+            printf("[SCALING %zu]: only %d of %u iterations run\n", steps, total.iterations, mcmc_params.iterations);
+            return seL4_IllegalOperation;
+        }
+        if (!total.clean) {
+            unclean++;
+        }
+        size_t attempts = total.requests + total.failures;
+        printf("[SCALING %zu]: peak %zu units %zu frames, cycles per alloc %" PRIu64 " per free %" PRIu64
+               ", %zu failed\n", steps, total.peak_units, total.peak_footprint,
+               attempts ? total.alloc_cycles / attempts : 0, total.frees ? total.free_cycles / total.frees : 0,
+               total.failures);
+        if (total.failures) {
+            break;
+        }
+    }
+    printf("\n[SCALING]: %zu steps, %zu not clean, %s cspace\n", steps, unclean,
+           config_set(CONFIG_MRMC_TWO_LEVEL_CSPACE) ? "two-level" : "single-level");
+    return seL4_NoError;
+}
+#endif
+
+#ifdef CONFIG_MRMC_CALIBRATE
+/***
+ * Calibration: the workload runs twice with the very same parameters and
+ * seed, against the null backend first and then against the allocator.
+ * The report of the second run splits its cycles into the ones of the
+ * driver (the whole first run), of the allocator at user level and of the
+ * kernel, see mcmc_calibration_report. With MRMCSmpWorkers, every worker
+ * runs both, and the cycles of all of them are split together.
+ */
+static int mcmc_calibrate_run(void)
+{
+    mcmc_result_t total;
+
+    printf("\n[CALIBRATE]: null backend\n");
+    mcmc_null_backend = true;
+    int err = mcmc_run(&total);
+    mcmc_null_backend = false;
+    if (err != seL4_NoError) {
+        return err;
+    }
+    mcmc_driver.valid = true;
+    mcmc_driver.cycles = MCMC_CALIBRATION_CYCLES(&total);
+    mcmc_driver.kernel_cycles = total.kernel_cycles;
+
+    printf("\n[CALIBRATE]: %s\n", MCMC_ALLOCATOR_NAME);
+    return mcmc_run(&total);
+}
+#endif
+
+#ifdef CONFIG_MRMC_REPLICAS
+/***
+ * Replicas: the same run is repeated with seeds MCMC_SEED, +1, +2, ...
+ * and three estimators are kept over them: requests per 10^9 cycles,
+ * failed requests in parts per million, and the mean footprint in frames.
+ * Once MCMC_REPLICAS_MIN replicas are in, the replicas stop as soon as the
+ * 95% confidence interval of every estimator is within MRMCReplicaTolerance
+ * thousandths of its mean, or after MRMCReplicaCount replicas anyway.
+ */
+#define MCMC_REPLICAS_MIN 3
+
+enum {
+    MCMC_ESTIMATE_RATE,
+    MCMC_ESTIMATE_FAILURES,
+    MCMC_ESTIMATE_FOOTPRINT,
+    MCMC_ESTIMATES
+};
+
+static const char *const mcmc_estimate_names[MCMC_ESTIMATES] = {
+    "requests_per_gcycle", "failures_ppm", "mean_footprint"
+};
+
+static void mcmc_replicas_report(const mcmc_stat_t *estimates, bool converged)
+{
+    mrmc_Record record = mrmc_Record_init_zero;
+    mrmc_Estimate *estimate = &record.payload.estimate;
+
+    record.which_payload = mrmc_Record_estimate_tag;
+    for (int e = 0; e < MCMC_ESTIMATES; ++e)
+    {
+        uint64_t ci = mcmc_stat_ci95(&estimates[e]);
+
+        printf("[REPLICAS]: %s %" PRIu64 " +- %" PRIu64 "\n", mcmc_estimate_names[e],
+               mcmc_stat_mean(&estimates[e]), ci == UINT64_MAX ? 0 : ci);
+        memset(estimate, 0, sizeof(*estimate));
+        strncpy(estimate->name, mcmc_estimate_names[e], sizeof(estimate->name) - 1);
+        estimate->replicas = estimates[e].count;
+        estimate->mean = mcmc_stat_mean(&estimates[e]);
+        estimate->has_ci95 = ci != UINT64_MAX;
+        estimate->ci95 = ci;
+        estimate->converged = converged;
+        mcmc_result_append(&record);
+    }
+    mcmc_result_flush();
+}
+
+static int mcmc_replicas_run(void)
+{
+    mcmc_stat_t estimates[MCMC_ESTIMATES];
+    size_t unclean = 0;
+    bool converged = false;
+    int replicas = 0;
+    mcmc_result_t total;
+
+    for (int e = 0; e < MCMC_ESTIMATES; ++e)
+    {
+        mcmc_stat_init(&estimates[e]);
+    }
+    while (!converged && replicas < CONFIG_MRMC_REPLICA_COUNT)
+    {
+        mcmc_params.seed = MCMC_SEED + replicas;
+        printf("\n[REPLICA %d]: seed %" PRIu64 "\n", ++replicas, mcmc_params.seed);
+
+        int err = mcmc_run(&total);
+        if (err != seL4_NoError) {
+            return err;
+        }
+        if (!total.clean) {
+            unclean++;
+        }
+        size_t attempts = total.requests + total.failures;
+        mcmc_stat_add(&estimates[MCMC_ESTIMATE_RATE],
+                      total.cycles ? total.requests * 1000000000ull / total.cycles : 0);
+        mcmc_stat_add(&estimates[MCMC_ESTIMATE_FAILURES],
+                      attempts ? total.failures * 1000000ull / attempts : 0);
+        mcmc_stat_add(&estimates[MCMC_ESTIMATE_FOOTPRINT],
+                      total.iterations ? total.footprint_sum / total.iterations : 0);
+
+        converged = replicas >= MCMC_REPLICAS_MIN;
+        for (int e = 0; e < MCMC_ESTIMATES; ++e)
+        {
+            converged = converged && mcmc_stat_converged(&estimates[e], CONFIG_MRMC_REPLICA_TOLERANCE);
+        }
+    }
+    printf("\n[REPLICAS]: %d replicas, %zu not clean, %s\n", replicas, unclean,
+           converged ? "converged" : "not converged");
+    mcmc_replicas_report(estimates, converged);
+    return seL4_NoError;
+}
+#endif
+
+#if defined(CONFIG_MRMC_SCHEDULE) || defined(CONFIG_MRMC_OBJECT_MIX)
+/* Most iterations of any run of the boot, for sizing what is drawn before a run */
+static uint32_t mcmc_draw_iterations(void)
+{
+#if defined(CONFIG_MRMC_SWEEP)
+    return mcmc_sweep_max(&mcmc_sweep, MCMC_SWEEP_ITERATIONS);
+#elif defined(CONFIG_MRMC_CAPACITY_SEARCH)
+    return CONFIG_MRMC_CAPACITY_ITERATIONS;
+#elif defined(CONFIG_MRMC_SCALING)
+    return CONFIG_MRMC_SCALING_ITERATIONS;
+#else
+    return mcmc_params.iterations;
+#endif
+}
+#endif
+
+/**
+ * Load the trace or parse the sweep, and work out how many units and
+ * frames may be outstanding at once. Runs before init_env, which sizes
+ * the metadata pool of allocman with it.
+ */
+static void mcmc_workload_init(void)
+{
+#ifdef CONFIG_MRMC_TRACE_REPLAY
+    mcmc_trace_load();
+    mcmc_live_units = mcmc_trace->max_live_units;
+    mcmc_live_frames = mcmc_trace->max_live_frames;
+#else
+    uint32_t free_frequency = mcmc_params.free_frequency;
+#ifdef CONFIG_MRMC_SWEEP
+    free_frequency = mcmc_sweep_init();
+#endif
+#ifdef CONFIG_MRMC_CAPACITY_SEARCH
+    free_frequency = CONFIG_MRMC_CAPACITY_MAX_FREE_FREQUENCY;
+#endif
+#ifdef CONFIG_MRMC_SCALING
+    free_frequency = CONFIG_MRMC_SCALING_MAX_FREE_FREQUENCY;
+#endif
+    mcmc_live_units = MCMC_MAX_LIVE_UNITS(free_frequency);
+    mcmc_live_frames = MCMC_MAX_LIVE_FRAMES(free_frequency);
+#ifdef CONFIG_MRMC_MEMORY_SERVER
+    /* The server holds the units of all of its clients */
+    mcmc_live_units *= CONFIG_MRMC_SERVER_CLIENTS;
+    mcmc_live_frames *= CONFIG_MRMC_SERVER_CLIENTS;
+#endif
+#endif
+    /* No more frames can be outstanding than there is untyped memory */
+    mcmc_live_frames = MIN(mcmc_live_frames, mcmc_untyped_frames());
+}
+
+void *__func_entry(void *arg UNUSED)
+{
+    int err;
+    printf("\n>>>>>>>> __func_entry__ <<<<<<<\n");
+    /**
+     * Bookkeeping arenas are reserved up front so as the timed region
+     * below does not go through the muslc heap.
+     */
+#ifdef MCMC_MULTI_RUN
+    mcmc_probes = (vka_object_t *)mcmc_pages_reserve(MCMC_PROBE_BLOCKS * sizeof(vka_object_t));
+#endif
+#ifdef MCMC_READS_CYCLES
+    sel4bench_init();
+#endif
+#ifdef CONFIG_MRMC_MAP_TOUCH
+    mcmc_map_attach(&env.vka);
+#endif
+#if defined(CONFIG_MRMC_SCHEDULE) || defined(CONFIG_MRMC_OBJECT_MIX)
+    mcmc_draw_length = mcmc_draw_iterations();
+#endif
+    for (int w = 0; w < MCMC_WORKERS; ++w)
+    {
+        mcmc_ctx[w].core = w;
+        mcmc_arena_init(&mcmc_ctx[w], mcmc_live_units, mcmc_live_frames);
+#ifdef CONFIG_MRMC_SCHEDULE
+        mcmc_ctx[w].schedule = (mcmc_schedule_t *)mcmc_pages_reserve(mcmc_draw_length * sizeof(mcmc_schedule_t));
+#endif
+#if defined(CONFIG_MRMC_OBJECT_MIX) && !defined(CONFIG_MRMC_SCHEDULE)
+        mcmc_ctx[w].objects = (mcmc_object_t *)mcmc_pages_reserve(mcmc_draw_length * sizeof(mcmc_object_t));
+#endif
+    }
+#ifdef CONFIG_MRMC_TRACE_CAPTURE
+    mcmc_trace_capture_init();
+#endif
+    size_t result_buffer_size = MCMC_RESULT_BUFFER_SIZE;
+#ifdef CONFIG_MRMC_SAMPLER
+#ifdef CONFIG_MRMC_TRACE_REPLAY
+    mcmc_sampler_reserve(mcmc_trace->iterations);
+#else
+    mcmc_sampler_reserve(MCMC_ITERATION_TIME);
+#endif
+    result_buffer_size += mcmc_sampler.capacity * MCMC_SAMPLE_RECORD_SIZE;
+#endif
+#ifdef CONFIG_MRMC_SMP_WORKERS
+    result_buffer_size += MCMC_WORKERS * MCMC_WORKER_RECORD_SIZE;
+#endif
+#ifdef CONFIG_MRMC_KERNEL_ENTRIES
+    result_buffer_size += MCMC_ENTRY_KINDS * MCMC_KERNEL_ENTRY_IDS * MCMC_KERNEL_ENTRY_RECORD_SIZE;
+#endif
+#ifdef CONFIG_MRMC_OBJECT_MIX
+    result_buffer_size += MCMC_OBJECTS * MCMC_OBJECT_RECORD_SIZE;
+#endif
+#ifdef CONFIG_MRMC_MEMORY_SERVER
+    result_buffer_size += CONFIG_MRMC_SERVER_CLIENTS * MCMC_CLIENT_RECORD_SIZE;
+#endif
+    mcmc_result_init(mcmc_pages_reserve(result_buffer_size), result_buffer_size);
+#ifdef CONFIG_MRMC_SMP_WORKERS
+    mcmc_workers_start();
+#endif
+#ifdef CONFIG_MRMC_MEMORY_SERVER
+    mcmc_clients_start();
+#endif
+#ifdef CONFIG_MRMC_SWEEP
+    err = mcmc_sweep_run();
+#elif defined(CONFIG_MRMC_CAPACITY_SEARCH)
+    mcmc_size_policy_init(mcmc_params.policy);
+    err = mcmc_capacity_run();
+#elif defined(CONFIG_MRMC_REPLICAS)
+    mcmc_size_policy_init(mcmc_params.policy);
+    err = mcmc_replicas_run();
+#elif defined(CONFIG_MRMC_SCALING)
+    mcmc_size_policy_init(mcmc_params.policy);
+    err = mcmc_scaling_run();
+#elif defined(CONFIG_MRMC_CALIBRATE)
+#ifndef CONFIG_MRMC_TRACE_REPLAY
+    mcmc_size_policy_init(mcmc_params.policy);
+#endif
+    err = mcmc_calibrate_run();
+#else
+    mcmc_result_t total;
+#ifndef CONFIG_MRMC_TRACE_REPLAY
+    mcmc_size_policy_init(mcmc_params.policy);
+#endif
+    err = mcmc_run(&total);
+#endif
+#ifdef CONFIG_MRMC_TRACE_CAPTURE
+    mcmc_trace_capture_dump();
+#endif
+    if (err != seL4_NoError) {
+        assert(0); // abort as error handling (temporarily)
+    }
+    printf("\n>>>>>>>> __func__exit__ <<<<<<<\n");
+}
+
+static void sel4test_exit(int code) {
+    /***
+     * Suspend first initial thread (which is the thread we are in)
+     * (add it into scheduling queue in kernel) through TCB_Suspend
+     * interface.
+     */
+    seL4_TCB_Suspend(seL4_CapInitThreadTCB);
+}
+
+int main(void)
+{
+    void *res;
+    sel4runtime_set_exit(sel4test_exit);
+    /***
+     * Receive bootinfo from sel4runtime, which is provided throughly
+     * by seL4 kernel, and use it to create & initial executing environment.
+     */
+    seL4_BootInfo *info = platsupport_get_bootinfo();
+    simple_default_init_bootinfo(&env.simple, info);
+    /***
+     * (Optional) To print the bootstrapping information.
+     */
+    if (config_set(CONFIG_MRMC_RESOURCE_INFO)) {
+        simple_print(&env.simple);
+    }
+    /***
+     * The workload decides how much metadata allocman may need.
+     */
+    mcmc_workload_init();
     /***
      * Initialize environment. Including allocator (allocman) bootstrapping,
      * vspace, I/O operations, etc,.
@@ -0,0 +1,67 @@
+/***
+ * Copyright 2023, zhuguangtao@iie.ac.cn, SKLOIS
+ *
+ * Binary result stream of MR-MC.
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <pb_encode.h>
+#include <mcmc/result.h>
+
+/* Bytes per dumped line, keeps every line well below 512 characters */
+#define HEX_DUMP_LINE_BYTES 192
+
+static pb_ostream_t result_stream;
+static uint8_t *result_buffer;
+static size_t result_size;
+static size_t result_records;
+static size_t result_dropped;
+
+void mcmc_result_init(void *buffer, size_t size)
+{
+    result_buffer = (uint8_t *)buffer;
+    result_size = size;
+    result_records = 0;
+    result_dropped = 0;
+    result_stream = pb_ostream_from_buffer(result_buffer, result_size);
+}
+
+bool mcmc_result_append(const mrmc_Record *record)
+{
+    /* Encode into a copy, so as a record which does not fit leaves no trace */
+    pb_ostream_t stream = result_stream;
+
+    if (!pb_encode_delimited(&stream, mrmc_Record_fields, record)) {
+        result_dropped++;
+        return false;
+    }
+    result_stream = stream;
+    result_records++;
+    return true;
+}
+
+void mcmc_result_flush(void)
+{
+    mcmc_hex_dump("PB", result_buffer, result_stream.bytes_written, result_records);
+    if (result_dropped) {
+        printf("[PB]: %zu records dropped, result buffer too small\n", result_dropped);
+    }
+    mcmc_result_init(result_buffer, result_size);
+}
+
+void mcmc_hex_dump(const char *tag, const void *data, size_t size, size_t count)
+{
+    const uint8_t *bytes = (const uint8_t *)data;
+
+    printf("\n[%s-BEGIN] %zu\n", tag, count);
+    for (size_t off = 0; off < size; off += HEX_DUMP_LINE_BYTES)
+    {
+        printf("[%s] ", tag);
+        for (size_t b = off; b < size && b < off + HEX_DUMP_LINE_BYTES; ++b)
+        {
+            printf("%02x", bytes[b]);
+        }
+        printf("\n");
+    }
+    printf("[%s-END]\n", tag);
+}
@@ -0,0 +1,31 @@
+/***
+ * Copyright 2023, zhuguangtao@iie.ac.cn, SKLOIS
+ *
+ * Time-series sampling of the MR-MC memory footprint.
+ */
+#include <mcmc/sampler.h>
+
+void mcmc_sampler_init(mcmc_sampler_t *sampler, mcmc_sample_t *ring, size_t capacity, uint32_t interval)
+{
+    sampler->ring = ring;
+    sampler->capacity = capacity;
+    sampler->taken = 0;
+    sampler->interval = capacity ? interval : 0;
+}
+
+mcmc_sample_t *mcmc_sampler_next(mcmc_sampler_t *sampler)
+{
+    return &sampler->ring[sampler->taken++ % sampler->capacity];
+}
+
+size_t mcmc_sampler_count(const mcmc_sampler_t *sampler)
+{
+    return sampler->taken < sampler->capacity ? sampler->taken : sampler->capacity;
+}
+
+const mcmc_sample_t *mcmc_sampler_get(const mcmc_sampler_t *sampler, size_t i)
+{
+    size_t oldest = sampler->taken - mcmc_sampler_count(sampler);
+
+    return &sampler->ring[(oldest + i) % sampler->capacity];
+}
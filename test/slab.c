@@ -0,0 +1,65 @@
+/***
+ * Copyright 2023, zhuguangtao@iie.ac.cn, SKLOIS
+ *
+ * Fixed-size slab arenas for MR-MC bookkeeping objects.
+ */
+#include <assert.h>
+#include <string.h>
+#include <mcmc/slab.h>
+
+static size_t slab_obj_size(size_t obj_size)
+{
+    if (obj_size < sizeof(void *)) {
+        obj_size = sizeof(void *);
+    }
+    return (obj_size + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+}
+
+size_t mcmc_slab_bytes(size_t obj_size, size_t capacity)
+{
+    return slab_obj_size(obj_size) * capacity;
+}
+
+void mcmc_slab_init(mcmc_slab_t *slab, void *mem, size_t obj_size, size_t capacity)
+{
+    char *obj = (char *)mem;
+
+    slab->obj_size = slab_obj_size(obj_size);
+    slab->capacity = capacity;
+    slab->in_use = 0;
+    slab->high_water = 0;
+    slab->free_list = NULL;
+    /**
+     * Thread the free list backwards so as the first allocations
+     * are served from the lowest addresses of the arena.
+     */
+    for (size_t i = capacity; i > 0; --i)
+    {
+        void **link = (void **)(obj + (i - 1) * slab->obj_size);
+        *link = slab->free_list;
+        slab->free_list = link;
+    }
+}
+
+void *mcmc_slab_alloc(mcmc_slab_t *slab)
+{
+    void **obj = (void **)slab->free_list;
+
+    if (obj == NULL) {
+        return NULL;
+    }
+    slab->free_list = *obj;
+    if (++slab->in_use > slab->high_water) {
+        slab->high_water = slab->in_use;
+    }
+    memset(obj, 0, slab->obj_size);
+    return obj;
+}
+
+void mcmc_slab_free(mcmc_slab_t *slab, void *obj)
+{
+    assert(slab->in_use > 0);
+    *(void **)obj = slab->free_list;
+    slab->free_list = obj;
+    slab->in_use--;
+}
@@ -0,0 +1,80 @@
+/***
+ * Copyright 2023, zhuguangtao@iie.ac.cn, SKLOIS
+ *
+ * Running estimators over independent replicas of an MR-MC run.
+ */
+#include <string.h>
+#include <mcmc/stats.h>
+
+/* Two-sided 95% quantiles of Student's t, in thousandths, by degrees of freedom */
+static const uint32_t stat_t95[] = {
+    12706, 4303, 3182, 2776, 2571, 2447, 2365, 2306, 2262, 2228,
+    2201, 2179, 2160, 2145, 2131, 2120, 2110, 2101, 2093, 2086,
+    2080, 2074, 2069, 2064, 2060, 2056, 2052, 2048, 2045, 2042
+};
+/* ... and of the normal distribution, for anything above */
+#define STAT_Z95 1960
+
+static uint64_t stat_isqrt(uint64_t value)
+{
+    uint64_t root = 0;
+    uint64_t bit = 1ull << 62;
+
+    while (bit > value)
+    {
+        bit >>= 2;
+    }
+    while (bit)
+    {
+        if (value >= root + bit) {
+            value -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return root;
+}
+
+void mcmc_stat_init(mcmc_stat_t *stat)
+{
+    memset(stat, 0, sizeof(*stat));
+}
+
+void mcmc_stat_add(mcmc_stat_t *stat, uint64_t value)
+{
+    stat->count++;
+    stat->sum += value;
+    stat->sum_sq += value * value;
+}
+
+uint64_t mcmc_stat_mean(const mcmc_stat_t *stat)
+{
+    return stat->count ? stat->sum / stat->count : 0;
+}
+
+uint64_t mcmc_stat_ci95(const mcmc_stat_t *stat)
+{
+    uint64_t n = stat->count;
+
+    if (n < 2) {
+        return UINT64_MAX;
+    }
+    /* sample variance of the mean: (n * sum_sq - sum^2) / (n^2 * (n - 1)) */
+    uint64_t spread = n * stat->sum_sq - stat->sum * stat->sum;
+    /* keep 10 fractional bits of the standard error, unless that overflows */
+    unsigned frac = spread < (1ull << 43) ? 10 : 0;
+    uint64_t se = stat_isqrt((spread << (2 * frac)) / (n * n * (n - 1)));
+    uint64_t t = n - 1 <= sizeof(stat_t95) / sizeof(stat_t95[0]) ? stat_t95[n - 2] : STAT_Z95;
+    uint64_t den = 1000ull << frac;
+
+    return (se * t + den - 1) / den;
+}
+
+bool mcmc_stat_converged(const mcmc_stat_t *stat, uint32_t tolerance)
+{
+    uint64_t ci = mcmc_stat_ci95(stat);
+
+    return ci != UINT64_MAX && ci * 1000 <= mcmc_stat_mean(stat) * tolerance;
+}
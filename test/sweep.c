@@ -0,0 +1,109 @@
+/***
+ * Copyright 2023, zhuguangtao@iie.ac.cn, SKLOIS
+ *
+ * Parameter grids for MR-MC sweeps.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <mcmc/sweep.h>
+
+static int sweep_parse_name(const char **p, const char *const *names, size_t name_count, uint32_t *value)
+{
+    size_t len = strcspn(*p, ",");
+
+    for (size_t i = 0; i < name_count; ++i)
+    {
+        if (strlen(names[i]) == len && strncmp(*p, names[i], len) == 0) {
+            *value = i;
+            *p += len;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static int sweep_parse_number(const char **p, uint32_t min_value, uint32_t *value)
+{
+    char *end;
+    unsigned long number = strtoul(*p, &end, 0);
+
+    if (end == *p || number < min_value || number > UINT32_MAX) {
+        return -1;
+    }
+    *value = number;
+    *p = end;
+    return 0;
+}
+
+int mcmc_sweep_parse(mcmc_sweep_t *sweep, int axis, const char *spec,
+                     const char *const *names, size_t name_count, uint32_t min_value)
+{
+    const char *p = spec;
+    size_t count = 0;
+
+    while (*p)
+    {
+        uint32_t *value = &sweep->values[axis][count];
+        int err;
+
+        if (count == MCMC_SWEEP_MAX_VALUES) {
+            return -1;
+        }
+        if (names) {
+            err = sweep_parse_name(&p, names, name_count, value);
+        } else {
+            err = sweep_parse_number(&p, min_value, value);
+        }
+        if (err) {
+            return -1;
+        }
+        count++;
+
+        if (*p == ',') {
+            p++;
+        } else if (*p) {
+            return -1;
+        }
+    }
+    sweep->counts[axis] = count;
+    return count ? 0 : -1;
+}
+
+size_t mcmc_sweep_points(const mcmc_sweep_t *sweep)
+{
+    size_t points = 1;
+
+    for (int axis = 0; axis < MCMC_SWEEP_AXES; ++axis)
+    {
+        points *= sweep->counts[axis];
+    }
+    return points;
+}
+
+uint32_t mcmc_sweep_max(const mcmc_sweep_t *sweep, int axis)
+{
+    uint32_t max = 0;
+
+    for (size_t i = 0; i < sweep->counts[axis]; ++i)
+    {
+        if (sweep->values[axis][i] > max) {
+            max = sweep->values[axis][i];
+        }
+    }
+    return max;
+}
+
+void mcmc_sweep_point(const mcmc_sweep_t *sweep, size_t index, mcmc_sweep_point_t *point)
+{
+    uint32_t value[MCMC_SWEEP_AXES];
+
+    for (int axis = MCMC_SWEEP_AXES - 1; axis >= 0; --axis)
+    {
+        value[axis] = sweep->values[axis][index % sweep->counts[axis]];
+        index /= sweep->counts[axis];
+    }
+    point->policy = value[MCMC_SWEEP_POLICY];
+    point->free_frequency = value[MCMC_SWEEP_FREE_FREQUENCY];
+    point->iterations = value[MCMC_SWEEP_ITERATIONS];
+    point->seed = value[MCMC_SWEEP_SEED];
+}
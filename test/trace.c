@@ -0,0 +1,34 @@
+/***
+ * Copyright 2023, zhuguangtao@iie.ac.cn, SKLOIS
+ *
+ * Binary alloc/free traces for MR-MC record and replay.
+ */
+#include <mcmc/trace.h>
+
+const mcmc_trace_header_t *mcmc_trace_check(const void *data, size_t size, uint32_t max_frames)
+{
+    const mcmc_trace_header_t *header = (const mcmc_trace_header_t *)data;
+    const mcmc_trace_record_t *record;
+    uint32_t iteration = 1;
+
+    if (data == NULL || ((uintptr_t)data & (sizeof(uint32_t) - 1)) || size < sizeof(*header)) {
+        return NULL;
+    }
+    if (header->magic != MCMC_TRACE_MAGIC || header->version != MCMC_TRACE_VERSION) {
+        return NULL;
+    }
+    if ((size - sizeof(*header)) / sizeof(*record) < header->records) {
+        return NULL;
+    }
+    record = mcmc_trace_records(header);
+    for (uint32_t i = 0; i < header->records; ++i, ++record)
+    {
+        if (record->iteration < iteration || record->iteration > header->iterations ||
+            record->expiry <= record->iteration ||
+            record->frames == 0 || record->frames > max_frames) {
+            return NULL;
+        }
+        iteration = record->iteration;
+    }
+    return header;
+}
@@ -0,0 +1,99 @@
+/***
+ * Copyright 2023, zhuguangtao@iie.ac.cn, SKLOIS
+ *
+ * Hierarchical timing wheel for MR-MC memory unit expiry.
+ */
+#include <assert.h>
+#include <string.h>
+#include <mcmc/wheel.h>
+
+/* Lowest iteration bits covered by the levels below 'level' */
+#define WHEEL_LEVEL_SHIFT(level)    ((level) * MCMC_WHEEL_LEVEL_BITS)
+#define WHEEL_RANGE_MASK(level)     ((1ul << WHEEL_LEVEL_SHIFT(level)) - 1)
+
+void mcmc_wheel_init(mcmc_wheel_t *wheel, size_t now)
+{
+    memset(wheel, 0, sizeof(*wheel));
+    wheel->now = now;
+}
+
+/**
+ * Place 'node' in the lowest level which resolves the highest bit in which
+ * its expiry differs from the current iteration. Nodes cascaded from upper
+ * levels may expire at the current iteration, public insertion may not.
+ */
+static void wheel_place(mcmc_wheel_t *wheel, mcmc_wheel_node_t *node)
+{
+    size_t diff = wheel->now ^ node->expiry;
+    int level = 0;
+
+    while (level < MCMC_WHEEL_LEVELS && diff >= (1ul << WHEEL_LEVEL_SHIFT(level + 1))) {
+        ++level;
+    }
+    if (level == MCMC_WHEEL_LEVELS) {
+        node->next = wheel->overflow;
+        wheel->overflow = node;
+        return;
+    }
+    mcmc_wheel_node_t **slot = &wheel->slots[level][(node->expiry >> WHEEL_LEVEL_SHIFT(level)) & MCMC_WHEEL_LEVEL_MASK];
+    node->next = *slot;
+    *slot = node;
+}
+
+static void wheel_cascade(mcmc_wheel_t *wheel, mcmc_wheel_node_t *list)
+{
+    mcmc_wheel_node_t *next;
+
+    while (list)
+    {
+        next = list->next;
+        wheel_place(wheel, list);
+        list = next;
+    }
+}
+
+void mcmc_wheel_insert(mcmc_wheel_t *wheel, mcmc_wheel_node_t *node)
+{
+    assert(node->expiry > wheel->now);
+    wheel_place(wheel, node);
+    wheel->pending++;
+}
+
+mcmc_wheel_node_t *mcmc_wheel_advance(mcmc_wheel_t *wheel)
+{
+    mcmc_wheel_node_t *list;
+    mcmc_wheel_node_t *node;
+    size_t now = ++wheel->now;
+    /**
+     * Whenever the iteration crosses the boundary of a level, the slot of
+     * that level which the iteration enters is redistributed downwards.
+     * This must go from the top level to the bottom one, as nodes cascaded
+     * from a level may land in the slot of the level below that is entered
+     * at the very same iteration.
+     */
+    if ((now & WHEEL_RANGE_MASK(MCMC_WHEEL_LEVELS)) == 0) {
+        list = wheel->overflow;
+        wheel->overflow = NULL;
+        wheel_cascade(wheel, list);
+    }
+    for (int level = MCMC_WHEEL_LEVELS - 1; level > 0; --level)
+    {
+        if ((now & WHEEL_RANGE_MASK(level)) != 0) {
+            continue;
+        }
+        mcmc_wheel_node_t **slot = &wheel->slots[level][(now >> WHEEL_LEVEL_SHIFT(level)) & MCMC_WHEEL_LEVEL_MASK];
+        list = *slot;
+        *slot = NULL;
+        wheel_cascade(wheel, list);
+    }
+    /* Everything left in the level 0 slot expires right now */
+    list = wheel->slots[0][now & MCMC_WHEEL_LEVEL_MASK];
+    wheel->slots[0][now & MCMC_WHEEL_LEVEL_MASK] = NULL;
+
+    for (node = list; node; node = node->next)
+    {
+        assert(node->expiry == now);
+        wheel->pending--;
+    }
+    return list;
+}
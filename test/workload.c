@@ -0,0 +1,131 @@
+/***
+ * Copyright 2023, zhuguangtao@iie.ac.cn, SKLOIS
+ *
+ * Random memory request workload of MR-MC.
+ */
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <mcmc/workload.h>
+
+const char *const mcmc_policy_names[MCMC_POLICIES] = {
+    "uniform-pow2", "uniform", "inverse-pow2", "table"
+};
+
+const char *const mcmc_object_names[MCMC_OBJECTS] = {
+    "frames", "tcb", "endpoint", "notification", "cnode", "page-table", "large-page"
+};
+
+int mcmc_workload_policy(mcmc_dist_t *dist, int policy, const char *table)
+{
+    static uint32_t values[MCMC_MAX_FRAME_COUNT];
+    static uint32_t weights[MCMC_MAX_FRAME_COUNT];
+    size_t entries = 0;
+
+    switch (policy) {
+    case MCMC_POLICY_TABLE:
+        if (table == NULL) {
+            return -1;
+        }
+        return mcmc_dist_parse(dist, table, MCMC_MAX_FRAME_COUNT);
+    case MCMC_POLICY_UNIFORM:
+        for (uint32_t frames = 1; frames < MCMC_MAX_FRAME_COUNT; ++frames)
+        {
+            values[entries] = frames;
+            weights[entries++] = 1;
+        }
+        break;
+    case MCMC_POLICY_UNIFORM_POW2:
+    case MCMC_POLICY_INVERSE_POW2:
+        for (int order = 0; order <= MCMC_MAX_ORDER; ++order)
+        {
+            values[entries] = 1u << order;
+            if (policy == MCMC_POLICY_INVERSE_POW2) {
+                weights[entries++] = order < MCMC_MAX_ORDER ? 1u << (MCMC_MAX_ORDER - order - 1) : 1;
+            } else {
+                weights[entries++] = 1;
+            }
+        }
+        break;
+    default:
+        return -1;
+    }
+    return mcmc_dist_build(dist, values, weights, entries);
+}
+
+int mcmc_workload_object_mix(mcmc_dist_t *dist, const char *spec)
+{
+    uint32_t values[MCMC_OBJECTS];
+    uint32_t weights[MCMC_OBJECTS];
+    size_t entries = 0;
+    const char *p = spec;
+    char *end;
+
+    while (*p)
+    {
+        size_t len = strcspn(p, ":,");
+        unsigned long weight = 1;
+        int kind = 0;
+
+        while (kind < MCMC_OBJECTS &&
+               (strlen(mcmc_object_names[kind]) != len || strncmp(p, mcmc_object_names[kind], len) != 0))
+        {
+            kind++;
+        }
+        if (kind == MCMC_OBJECTS || entries == MCMC_OBJECTS) {
+            return -1;
+        }
+        p += len;
+        if (*p == ':') {
+            weight = strtoul(++p, &end, 0);
+            if (end == p || weight > MCMC_DIST_MAX_WEIGHT) {
+                return -1;
+            }
+            p = end;
+        }
+        values[entries] = kind;
+        weights[entries] = weight;
+        entries++;
+
+        if (*p == ',') {
+            p++;
+        } else if (*p) {
+            return -1;
+        }
+    }
+    return mcmc_dist_build(dist, values, weights, entries);
+}
+
+int mcmc_workload_schedule(mcmc_rng_t *rng, const mcmc_dist_t *dist, const mcmc_dist_t *mix,
+                           uint32_t free_frequency, mcmc_schedule_t *schedule, uint32_t iterations)
+{
+    mcmc_trace_record_t req;
+
+    if (free_frequency - 1 > MCMC_SCHEDULE_MAX_LIFETIME || dist->max_value > MCMC_MAX_FRAME_COUNT) {
+        return -1;
+    }
+    for (uint32_t i = 1; i <= iterations; ++i)
+    {
+        uint32_t radix = 0;
+        int kind = mix ? mcmc_workload_draw_object(rng, mix, &radix) : MCMC_OBJECT_FRAMES;
+
+        schedule[i - 1] = (mcmc_schedule_t)mcmc_object_pack(kind, radix) << MCMC_SCHEDULE_FRAME_BITS;
+    }
+    for (uint32_t i = 1; i <= iterations; ++i)
+    {
+        mcmc_workload_draw(rng, dist, free_frequency, i, &req);
+        schedule[i - 1] |= ((req.expiry - i) << MCMC_SCHEDULE_LIFETIME_SHIFT) | (req.frames - 1);
+    }
+    return 0;
+}
+
+void mcmc_workload_objects(mcmc_rng_t *rng, const mcmc_dist_t *mix, mcmc_object_t *objects, uint32_t iterations)
+{
+    for (uint32_t i = 1; i <= iterations; ++i)
+    {
+        uint32_t radix = 0;
+        int kind = mcmc_workload_draw_object(rng, mix, &radix);
+
+        objects[i - 1] = mcmc_object_pack(kind, radix);
+    }
+}
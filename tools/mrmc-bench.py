@@ -0,0 +1,262 @@
+#!/usr/bin/env python3
+#
+# Copyright 2023, zhuguangtao@iie.ac.cn, SKLOIS
+#
+# Benchmark matrix of MR-MC under the QEMU simulator, with regression checks.
+#
+# Every configuration of the matrix (tools/mrmc-bench.json) is built with
+# init-build.sh into a build directory of its own and booted --repeat times
+# with ./simulate. The RunResult of every boot is decoded from its result
+# stream (see mrmc-decode.py), and the median of every metric is compared
+# against the baseline:
+#   - metrics with a threshold (cycles) regress once they grow by more than
+#     their threshold, relative to the baseline
+#   - 'exact' metrics (requests, frames, ...) must not change at all, as
+#     they only depend on the workload, and cycles of different workloads
+#     cannot be compared
+# The baseline also records the revisions pinned in default.xml, so as a bump
+# of seL4_libs-vbtalloc-extension shows up next to the regressions it causes.
+#
+#   $ ../projects/testcase-MR-MC/tools/mrmc-bench.py --work-dir bench --update-baseline
+#   $ ../projects/testcase-MR-MC/tools/mrmc-bench.py --work-dir bench   # exits 1 on regressions
+#
+
+import argparse
+import importlib.util
+import json
+import os
+import select
+import signal
+import statistics
+import subprocess
+import sys
+import time
+import xml.etree.ElementTree as ET
+
+TOOLS_DIR = os.path.dirname(os.path.abspath(__file__))
+PROJECT_DIR = os.path.dirname(TOOLS_DIR)
+# projects/testcase-MR-MC within the repo checkout
+TOP_DIR = os.path.dirname(os.path.dirname(PROJECT_DIR))
+
+# Console lines at which a boot is over, one way or the other
+EXIT_MARKER = '__func__exit__'
+FAILURE_MARKERS = ('Assertion failed', 'seL4 root server abort', 'Caught cap fault', 'vm fault')
+
+
+def load_decoder():
+    spec = importlib.util.spec_from_file_location('mrmc_decode', os.path.join(TOOLS_DIR, 'mrmc-decode.py'))
+    module = importlib.util.module_from_spec(spec)
+    spec.loader.exec_module(module)
+    return module
+
+
+def revisions(manifest):
+    """Revision of every project pinned in a repo manifest, by path."""
+    if not os.path.exists(manifest):
+        return {}
+    root = ET.parse(manifest).getroot()
+    return {p.get('path'): p.get('revision') for p in root.iter('project') if p.get('revision')}
+
+
+def build(build_dir, defines, log):
+    os.makedirs(build_dir, exist_ok=True)
+    command = [os.path.join(TOP_DIR, 'init-build.sh')] + ['-D%s=%s' % item for item in defines.items()]
+    with open(log, 'w') as f:
+        for step in (command, ['ninja']):
+            if subprocess.call(step, cwd=build_dir, stdout=f, stderr=subprocess.STDOUT):
+                return False
+    return True
+
+
+def boot(build_dir, log, timeout):
+    """Run ./simulate until the rootserver is done, failed or timed out.
+
+    @return None on success, else what went wrong.
+    """
+    deadline = time.monotonic() + timeout
+    outcome = 'timed out after %ds' % timeout
+    with open(log, 'w') as f:
+        proc = subprocess.Popen(['./simulate'], cwd=build_dir, stdin=subprocess.DEVNULL,
+                                stdout=subprocess.PIPE, stderr=subprocess.STDOUT, start_new_session=True)
+        try:
+            pending = ''
+            while time.monotonic() < deadline:
+                if not select.select([proc.stdout], [], [], 0.5)[0]:
+                    continue
+                chunk = os.read(proc.stdout.fileno(), 65536).decode('utf-8', 'replace')
+                if not chunk:
+                    outcome = 'simulator exited with %d' % proc.wait()
+                    break
+                f.write(chunk)
+                lines = (pending + chunk).split('\n')
+                pending = lines.pop()
+                if any(EXIT_MARKER in line for line in lines):
+                    outcome = None
+                    break
+                failed = [line for line in lines if any(m in line for m in FAILURE_MARKERS)]
+                if failed:
+                    outcome = failed[0].strip()
+                    break
+        finally:
+            # QEMU does not exit once the rootserver is done
+            if proc.poll() is None:
+                os.killpg(proc.pid, signal.SIGKILL)
+            proc.wait()
+    return outcome
+
+
+def run_result(decoder, log):
+    """RunResult of the first dump of a console log, or None."""
+    for data in decoder.dumps(log):
+        for kind, row in decoder.decode_records(data):
+            if kind == 'run':
+                return row
+    return None
+
+
+def measure(args, matrix, decoder, name):
+    """Boot one configuration --repeat times.
+
+    @return (median of every metric, list of failures).
+    """
+    build_dir = os.path.join(args.work_dir, name)
+    defines = dict(matrix.get('common', {}))
+    defines.update(matrix['configurations'][name])
+    defines.update(dict(d.split('=', 1) for d in args.define))
+    if not args.no_build:
+        print('[%s] building' % name, flush=True)
+        if not build(build_dir, defines, os.path.join(args.work_dir, name + '.build.log')):
+            return None, ['build failed, see %s.build.log' % name]
+
+    samples = []
+    failures = []
+    for r in range(args.repeat):
+        log = os.path.join(args.work_dir, '%s.%d.log' % (name, r))
+        if not args.no_build:
+            print('[%s] boot %d/%d' % (name, r + 1, args.repeat), flush=True)
+            outcome = boot(build_dir, log, args.timeout)
+            if outcome:
+                failures.append('boot %d: %s' % (r, outcome))
+                continue
+        row = run_result(decoder, log) if os.path.exists(log) else None
+        if row is None:
+            failures.append('boot %d: no result stream in %s' % (r, log))
+        elif row.get('error'):
+            failures.append('boot %d: run failed with error %d' % (r, row['error']))
+        else:
+            samples.append(row)
+    if not samples:
+        return None, failures
+
+    metrics = set(matrix.get('thresholds', {})) | set(matrix.get('exact', []))
+    medians = {}
+    for metric in sorted(metrics):
+        values = [row[metric] for row in samples if metric in row]
+        if values:
+            medians[metric] = statistics.median_low(values)
+            medians[metric + '_spread'] = max(values) - min(values)
+    return medians, failures
+
+
+def compare(matrix, name, medians, baseline):
+    """Print one configuration against its baseline.
+
+    @return the number of regressions (and workload changes).
+    """
+    regressions = 0
+    thresholds = matrix.get('thresholds', {})
+    for metric in matrix.get('exact', []):
+        if metric in medians and metric in baseline and medians[metric] != baseline[metric]:
+            print('  %-16s %14d -> %14d  CHANGED (workload differs from the baseline)'
+                  % (metric, baseline[metric], medians[metric]))
+            regressions += 1
+    for metric, threshold in sorted(thresholds.items()):
+        if metric not in medians:
+            continue
+        value = medians[metric]
+        base = baseline.get(metric)
+        if not base:
+            print('  %-16s %14s -> %14d  no baseline' % (metric, '-', value))
+            continue
+        delta = (value - base) / base
+        status = 'ok'
+        if delta > threshold:
+            status = 'REGRESSION'
+            regressions += 1
+        elif delta < -threshold:
+            status = 'improved'
+        # repeats further apart than the threshold cannot tell anything apart
+        if value and medians[metric + '_spread'] / value > threshold:
+            status += ' (noisy)'
+        print('  %-16s %14d -> %14d  %+6.1f%% (threshold %.1f%%) %s'
+              % (metric, base, value, delta * 100, threshold * 100, status))
+    return regressions
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Build, boot and check the MR-MC benchmark matrix under QEMU')
+    parser.add_argument('--matrix', default=os.path.join(TOOLS_DIR, 'mrmc-bench.json'))
+    parser.add_argument('--baseline', default=os.path.join(TOOLS_DIR, 'mrmc-baseline.json'))
+    parser.add_argument('--work-dir', default='bench', help='build directories and console logs')
+    parser.add_argument('--only', help='comma separated configurations of the matrix')
+    parser.add_argument('--repeat', type=int, default=3, help='boots per configuration, compared by median')
+    parser.add_argument('--timeout', type=int, default=900, help='seconds per boot')
+    parser.add_argument('-D', '--define', action='append', default=[], help='extra KEY=VALUE for init-build.sh')
+    parser.add_argument('--no-build', action='store_true', help='only check the logs of a previous run')
+    parser.add_argument('--update-baseline', action='store_true', help='store the medians as the new baseline')
+    args = parser.parse_args()
+
+    with open(args.matrix) as f:
+        matrix = json.load(f)
+    names = args.only.split(',') if args.only else list(matrix['configurations'])
+    unknown = [name for name in names if name not in matrix['configurations']]
+    if unknown:
+        sys.exit('unknown configurations: %s' % ', '.join(unknown))
+    baseline = {'revisions': {}, 'configurations': {}}
+    if os.path.exists(args.baseline):
+        with open(args.baseline) as f:
+            baseline = json.load(f)
+    elif not args.update_baseline:
+        print('no baseline at %s, record one with --update-baseline' % args.baseline)
+    os.makedirs(args.work_dir, exist_ok=True)
+
+    decoder = load_decoder()
+    current = revisions(os.path.join(PROJECT_DIR, 'default.xml'))
+    for path, revision in sorted(current.items()):
+        pinned = baseline['revisions'].get(path)
+        if pinned and pinned != revision:
+            print('%s: %s in the baseline, now %s' % (path, pinned, revision))
+
+    failed = 0
+    regressions = 0
+    results = {}
+    for name in names:
+        medians, failures = measure(args, matrix, decoder, name)
+        print('\n[%s]' % name)
+        for failure in failures:
+            print('  FAILED %s' % failure)
+        failed += bool(failures)
+        if medians is None:
+            continue
+        results[name] = {k: v for k, v in medians.items() if not k.endswith('_spread')}
+        regressions += compare(matrix, name, medians, baseline['configurations'].get(name, {}))
+
+    with open(os.path.join(args.work_dir, 'results.json'), 'w') as f:
+        json.dump({'revisions': current, 'configurations': results}, f, indent=4, sort_keys=True)
+    if args.update_baseline:
+        if failed:
+            sys.exit('\nnot updating the baseline, %d configurations failed' % failed)
+        baseline['revisions'] = current
+        baseline['configurations'].update(results)
+        with open(args.baseline, 'w') as f:
+            json.dump(baseline, f, indent=4, sort_keys=True)
+            f.write('\n')
+        print('\nbaseline updated: %s' % args.baseline)
+        return
+    print('\n%d configurations, %d failed, %d regressions' % (len(names), failed, regressions))
+    if failed or regressions:
+        sys.exit(1)
+
+
+if __name__ == '__main__':
+    main()
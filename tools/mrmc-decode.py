@@ -0,0 +1,265 @@
+#!/usr/bin/env python3
+#
+# Copyright 2023, zhuguangtao@iie.ac.cn, SKLOIS
+#
+# Decode the binary result stream of MR-MC runs into CSV.
+#
+# Every run dumps its results between "[PB-BEGIN] <records>" and "[PB-END]"
+# as hex lines "[PB] ...", holding length-delimited mrmc.Record messages
+# (test/proto/mrmc.proto). For every kind of record, one CSV file is written,
+# with the console log ('source') and the index of the dump in it ('run').
+#
+#   $ tools/mrmc-decode.py --out-dir results logs/*.log
+#   -> results/run.csv, results/latency.csv, ...
+#
+
+import argparse
+import csv
+import os
+import re
+import sys
+
+# field number -> (column, type), in the order of test/proto/mrmc.proto
+RUN_RESULT = {
+    1: ('allocator', 'string'),
+    2: ('iterations', 'uint'),
+    3: ('requests', 'uint'),
+    4: ('total_frames', 'uint'),
+    5: ('error', 'int'),
+    6: ('tcb_cycles', 'uint'),
+    7: ('kernel_cycles', 'uint'),
+    8: ('workers', 'uint'),
+    9: ('magazine_hits', 'uint'),
+    10: ('magazine_misses', 'uint'),
+    11: ('magazine_drained', 'uint'),
+    12: ('policy', 'string'),
+    13: ('free_frequency', 'uint'),
+    14: ('seed', 'uint'),
+    15: ('clean', 'uint'),
+    16: ('peak_footprint', 'uint'),
+    17: ('free_epoch', 'uint'),
+    18: ('epochs', 'uint'),
+    19: ('max_epoch_units', 'uint'),
+    20: ('failures', 'uint'),
+    21: ('first_failure', 'uint'),
+    22: ('load', 'uint'),
+    23: ('metadata_bytes_start', 'uint'),
+    24: ('metadata_bytes_peak', 'uint'),
+    25: ('mapped_pages', 'uint'),
+    26: ('mapped_large_pages', 'uint'),
+    27: ('map_cycles', 'uint'),
+    28: ('unmap_cycles', 'uint'),
+    29: ('paging_objects', 'uint'),
+    30: ('kernel_log_entries', 'uint'),
+    31: ('kernel_log_full', 'uint'),
+    32: ('mean_footprint', 'uint'),
+    33: ('cycles', 'uint'),
+    34: ('peak_units', 'uint'),
+    35: ('alloc_cycles', 'uint'),
+    36: ('free_cycles', 'uint'),
+    37: ('frees', 'uint'),
+    38: ('driver_cycles', 'uint'),
+    39: ('allocator_cycles', 'int'),
+    40: ('allocator_kernel_cycles', 'int'),
+    41: ('clients', 'uint'),
+    42: ('batch_size', 'uint'),
+    43: ('batches', 'uint'),
+    44: ('round_trip_cycles', 'uint'),
+    45: ('large_page_cycles', 'uint'),
+    46: ('epoch_order_min', 'sint'),
+    47: ('epoch_order_sum', 'sint'),
+    48: ('probe_cycles', 'uint'),
+    49: ('probe_kernel_cycles', 'uint'),
+}
+
+LATENCY = {
+    1: ('op', 'string'),
+    2: ('order', 'uint'),
+    3: ('count', 'uint'),
+    4: ('sum', 'uint'),
+    5: ('p50', 'uint'),
+    6: ('p99', 'uint'),
+    7: ('p999', 'uint'),
+    8: ('max', 'uint'),
+}
+
+SAMPLE = {
+    1: ('iteration', 'uint'),
+    2: ('live_units', 'uint'),
+    3: ('live_frames', 'uint'),
+    4: ('largest_order', 'sint'),
+    5: ('metadata_bytes', 'uint'),
+}
+
+WORKER = {
+    1: ('core', 'uint'),
+    2: ('iterations', 'uint'),
+    3: ('requests', 'uint'),
+    4: ('total_frames', 'uint'),
+    5: ('error', 'int'),
+    6: ('tcb_cycles', 'uint'),
+    7: ('kernel_cycles', 'uint'),
+}
+
+KERNEL_ENTRY = {
+    1: ('kind', 'string'),
+    2: ('id', 'uint'),
+    3: ('name', 'string'),
+    4: ('count', 'uint'),
+    5: ('cycles', 'uint'),
+    6: ('max', 'uint'),
+}
+
+ESTIMATE = {
+    1: ('name', 'string'),
+    2: ('replicas', 'uint'),
+    3: ('mean', 'uint'),
+    4: ('ci95', 'uint'),
+    5: ('converged', 'uint'),
+}
+
+OBJECT_KIND = {
+    1: ('kind', 'string'),
+    2: ('allocs', 'uint'),
+    3: ('frees', 'uint'),
+    4: ('alloc_cycles', 'uint'),
+    5: ('free_cycles', 'uint'),
+    6: ('alloc_max', 'uint'),
+    7: ('free_max', 'uint'),
+}
+
+CLIENT = {
+    1: ('index', 'uint'),
+    2: ('iterations', 'uint'),
+    3: ('requests', 'uint'),
+    4: ('frees', 'uint'),
+    5: ('total_frames', 'uint'),
+    6: ('error', 'int'),
+    7: ('batches', 'uint'),
+    8: ('round_trip_sum', 'uint'),
+    9: ('batch_p50', 'uint'),
+    10: ('batch_p99', 'uint'),
+    11: ('batch_max', 'uint'),
+    12: ('cycles', 'uint'),
+    13: ('request_p50', 'uint'),
+    14: ('request_p99', 'uint'),
+    15: ('request_max', 'uint'),
+}
+
+# oneof payload of mrmc.Record -> (csv name, fields)
+RECORD = {
+    1: ('run', RUN_RESULT),
+    2: ('latency', LATENCY),
+    3: ('sample', SAMPLE),
+    4: ('worker', WORKER),
+    5: ('kernel_entry', KERNEL_ENTRY),
+    6: ('estimate', ESTIMATE),
+    7: ('object_kind', OBJECT_KIND),
+    8: ('client', CLIENT),
+}
+
+
+def varint(data, pos):
+    value = shift = 0
+    while True:
+        byte = data[pos]
+        pos += 1
+        value |= (byte & 0x7f) << shift
+        shift += 7
+        if not byte & 0x80:
+            return value, pos
+
+
+def fields(data):
+    """Yield (field number, wire type, value) of one message."""
+    pos = 0
+    while pos < len(data):
+        key, pos = varint(data, pos)
+        number, wire = key >> 3, key & 7
+        if wire == 0:
+            value, pos = varint(data, pos)
+        elif wire == 1:
+            value, pos = int.from_bytes(data[pos:pos + 8], 'little'), pos + 8
+        elif wire == 2:
+            length, pos = varint(data, pos)
+            value, pos = data[pos:pos + length], pos + length
+        elif wire == 5:
+            value, pos = int.from_bytes(data[pos:pos + 4], 'little'), pos + 4
+        else:
+            raise ValueError('unsupported wire type %d' % wire)
+        yield number, wire, value
+
+
+def decode_message(data, schema):
+    row = {}
+    for number, _, value in fields(data):
+        if number not in schema:
+            continue
+        name, kind = schema[number]
+        if kind == 'string':
+            value = value.decode('utf-8', 'replace')
+        elif kind == 'int' and value >= 1 << 63:
+            value -= 1 << 64
+        elif kind == 'sint':
+            value = (value >> 1) ^ -(value & 1)
+        row[name] = value
+    return row
+
+
+def decode_records(data):
+    pos = 0
+    while pos < len(data):
+        length, pos = varint(data, pos)
+        record, pos = data[pos:pos + length], pos + length
+        for number, _, payload in fields(record):
+            if number in RECORD:
+                kind, schema = RECORD[number]
+                yield kind, decode_message(payload, schema)
+
+
+def dumps(path):
+    """Yield the payload of every [PB] dump in a console log."""
+    payload = None
+    with open(path, errors='replace') as f:
+        for line in f:
+            if '[PB-BEGIN]' in line:
+                payload = []
+            elif '[PB-END]' in line and payload is not None:
+                yield b''.join(payload)
+                payload = None
+            elif payload is not None:
+                match = re.search(r'\[PB\] ([0-9a-fA-F]+)', line)
+                if match:
+                    payload.append(bytes.fromhex(match.group(1)))
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Decode MR-MC result streams into CSV')
+    parser.add_argument('logs', nargs='+', help='console logs of MR-MC runs')
+    parser.add_argument('--out-dir', default='.', help='directory for the <record>.csv files')
+    args = parser.parse_args()
+
+    rows = {}
+    for path in args.logs:
+        for run, data in enumerate(dumps(path)):
+            for kind, row in decode_records(data):
+                rows.setdefault(kind, []).append(dict(source=path, run=run, **row))
+
+    if not rows:
+        sys.exit('no result stream found')
+    os.makedirs(args.out_dir, exist_ok=True)
+    for kind, _ in RECORD.values():
+        if kind not in rows:
+            continue
+        columns = ['source', 'run']
+        for row in rows[kind]:
+            columns += [column for column in row if column not in columns]
+        with open(os.path.join(args.out_dir, kind + '.csv'), 'w', newline='') as f:
+            writer = csv.DictWriter(f, columns)
+            writer.writeheader()
+            writer.writerows(rows[kind])
+        print('%s: %d rows' % (os.path.join(args.out_dir, kind + '.csv'), len(rows[kind])))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,176 @@
+#!/usr/bin/env python3
+#
+# Copyright 2023, zhuguangtao@iie.ac.cn, SKLOIS
+#
+# Host tool for MR-MC alloc/free traces (see test/include/mcmc/trace.h).
+#
+#   generate -> draw a synthetic trace, mirroring the size policies of mce.c
+#   capture  -> rebuild the trace dumped by an MRMCTraceCapture run from its console log
+#   import   -> convert a CSV of real requests (iteration,frames,expiry) into a trace
+#   info     -> print the header of a trace
+#
+# The trace is embedded into the image with
+#   -DMRMCTraceReplay=ON -DMRMCTraceFile=/path/to/file.trace
+#
+
+import argparse
+import csv
+import heapq
+import random
+import re
+import struct
+import sys
+
+TRACE_MAGIC = 0x434d524d
+TRACE_VERSION = 1
+HEADER = struct.Struct('<6I')
+RECORD = struct.Struct('<3I')
+MAX_FRAME_COUNT = 1024
+MAX_ORDER = 10
+
+POLICIES = {
+    'uniform-pow2': [(1 << order, 1) for order in range(MAX_ORDER + 1)],
+    'uniform': [(frames, 1) for frames in range(1, MAX_FRAME_COUNT)],
+    'inverse-pow2': [(1 << order, 1 << (MAX_ORDER - order - 1) if order < MAX_ORDER else 1)
+                     for order in range(MAX_ORDER + 1)],
+}
+
+
+def parse_table(spec):
+    table = []
+    for item in spec.split(','):
+        frames, _, weight = item.partition(':')
+        table.append((int(frames, 0), int(weight, 0) if weight else 1))
+    return table
+
+
+def check(records):
+    last = 1
+    for iteration, expiry, frames in records:
+        if iteration < last or expiry <= iteration or not 1 <= frames <= MAX_FRAME_COUNT:
+            raise ValueError('invalid record (%d, %d, %d)' % (iteration, expiry, frames))
+        last = iteration
+
+
+def peaks(records):
+    """Peak outstanding units/frames, in the order mce.c allocates and frees."""
+    live = []
+    units = frames = max_units = max_frames = 0
+    for iteration, expiry, count in records:
+        while live and live[0][0] < iteration:
+            _, freed = heapq.heappop(live)
+            units -= 1
+            frames -= freed
+        heapq.heappush(live, (expiry, count))
+        units += 1
+        frames += count
+        max_units = max(max_units, units)
+        max_frames = max(max_frames, frames)
+    return max_units, max_frames
+
+
+def write(path, records):
+    check(records)
+    max_units, max_frames = peaks(records)
+    iterations = records[-1][0] if records else 0
+    with open(path, 'wb') as f:
+        f.write(HEADER.pack(TRACE_MAGIC, TRACE_VERSION, len(records), iterations, max_units, max_frames))
+        for record in records:
+            f.write(RECORD.pack(*record))
+    print('%s: %d records, %d iterations, peak %d units / %d frames'
+          % (path, len(records), iterations, max_units, max_frames))
+
+
+def read(path):
+    with open(path, 'rb') as f:
+        data = f.read()
+    magic, version, count, iterations, max_units, max_frames = HEADER.unpack_from(data)
+    if magic != TRACE_MAGIC or version != TRACE_VERSION:
+        raise ValueError('%s is not an MR-MC trace' % path)
+    records = [RECORD.unpack_from(data, HEADER.size + i * RECORD.size) for i in range(count)]
+    return (iterations, max_units, max_frames), records
+
+
+def cmd_generate(args):
+    rng = random.Random(args.seed)
+    table = parse_table(args.table) if args.table else POLICIES[args.policy]
+    sizes = [frames for frames, _ in table]
+    weights = [weight for _, weight in table]
+    records = []
+    for i in range(1, args.iterations + 1):
+        # get_random_time(): uniform in [1, free_frequency)
+        expiry = i + rng.randrange(1, args.free_frequency)
+        records.append((i, expiry, rng.choices(sizes, weights)[0]))
+    write(args.output, records)
+
+
+def cmd_capture(args):
+    payload = []
+    inside = False
+    with open(args.log, errors='replace') as f:
+        for line in f:
+            if '[TRACE-BEGIN]' in line:
+                inside, payload = True, []
+            elif '[TRACE-END]' in line:
+                inside = False
+            elif inside:
+                match = re.search(r'\[TRACE\] ([0-9a-fA-F]+)', line)
+                if match:
+                    payload.append(bytes.fromhex(match.group(1)))
+    data = b''.join(payload)
+    if not data or len(data) % RECORD.size:
+        sys.exit('no complete trace dump found in %s' % args.log)
+    write(args.output, [RECORD.unpack_from(data, off) for off in range(0, len(data), RECORD.size)])
+
+
+def cmd_import(args):
+    records = []
+    with open(args.csv, newline='') as f:
+        for row in csv.reader(f):
+            if not row or not row[0].strip().isdigit():
+                continue
+            iteration, frames, expiry = (int(col) for col in row[:3])
+            records.append((iteration, expiry, frames))
+    records.sort(key=lambda record: record[0])
+    write(args.output, records)
+
+
+def cmd_info(args):
+    (iterations, max_units, max_frames), records = read(args.trace)
+    print('records %d iterations %d peak units %d peak frames %d'
+          % (len(records), iterations, max_units, max_frames))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    sub = parser.add_subparsers(dest='command', required=True)
+
+    p = sub.add_parser('generate', help='draw a synthetic trace')
+    p.add_argument('-o', '--output', required=True)
+    p.add_argument('--iterations', type=int, default=80000)
+    p.add_argument('--free-frequency', type=int, default=80)
+    p.add_argument('--policy', choices=sorted(POLICIES), default='uniform-pow2')
+    p.add_argument('--table', help='frames:weight,... (overrides --policy)')
+    p.add_argument('--seed', type=int, default=0)
+    p.set_defaults(func=cmd_generate)
+
+    p = sub.add_parser('capture', help='rebuild a trace from an MRMCTraceCapture console log')
+    p.add_argument('log')
+    p.add_argument('-o', '--output', required=True)
+    p.set_defaults(func=cmd_capture)
+
+    p = sub.add_parser('import', help='convert iteration,frames,expiry CSV rows')
+    p.add_argument('csv')
+    p.add_argument('-o', '--output', required=True)
+    p.set_defaults(func=cmd_import)
+
+    p = sub.add_parser('info', help='print the header of a trace')
+    p.add_argument('trace')
+    p.set_defaults(func=cmd_info)
+
+    args = parser.parse_args()
+    args.func(args)
+
+
+if __name__ == '__main__':
+    main()